@@ -0,0 +1,285 @@
+#include "BlockSource.h"
+#include "Logger.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Reads ahead on a helper thread into a ring of READ_AHEAD buffers
+class ThreadBlockSource : public BlockSource {
+public:
+    ThreadBlockSource(FILE* f)
+        : file(f), buffers(READ_AHEAD), sizes(READ_AHEAD, 0),
+          filled(0), consumed(0), handedOut(false), done(false), stop(false) {
+        for (std::vector<char>& buffer : buffers) {
+            buffer.resize(BLOCK_SIZE);
+        }
+        reader = std::thread(&ThreadBlockSource::ReadLoop, this);
+    }
+
+    ~ThreadBlockSource() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        changed.notify_all();
+        reader.join();
+        fclose(file);
+    }
+
+    bool Next(const char*& data, size_t& size) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        // The block handed out last time may be refilled now
+        if (handedOut) {
+            consumed++;
+            handedOut = false;
+            changed.notify_all();
+        }
+        changed.wait(lock, [this] { return filled > consumed || done; });
+        if (filled == consumed) {
+            return false;
+        }
+
+        size_t slot = (size_t)(consumed % READ_AHEAD);
+        data = buffers[slot].data();
+        size = sizes[slot];
+        handedOut = true;
+        return true;
+    }
+
+private:
+    void ReadLoop() {
+        for (;;) {
+            size_t slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this] { return filled - consumed < (uint64_t)READ_AHEAD || stop; });
+                if (stop) {
+                    return;
+                }
+                slot = (size_t)(filled % READ_AHEAD);
+            }
+
+            size_t size = fread(buffers[slot].data(), 1, BLOCK_SIZE, file);
+            bool error = ferror(file) != 0;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (size > 0) {
+                sizes[slot] = size;
+                filled++;
+            }
+            if (size < BLOCK_SIZE) {
+                failed = error;
+                done = true;
+                changed.notify_all();
+                return;
+            }
+            changed.notify_all();
+        }
+    }
+
+    FILE* file;
+    std::vector<std::vector<char>> buffers;
+    std::vector<size_t> sizes;
+    uint64_t filled;    // blocks read so far
+    uint64_t consumed;  // blocks released by the consumer
+    bool handedOut;
+    bool done;
+    bool stop;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread reader;
+};
+
+std::unique_ptr<BlockSource> OpenThreadBlockSource(const std::string& fname, uint64_t offset) {
+    FILE* file = fopen(fname.c_str(), "rb");
+    if (!file) {
+        return nullptr;
+    }
+#ifdef _WIN32
+    int seeked = _fseeki64(file, (long long)offset, SEEK_SET);
+#else
+    int seeked = fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+    if (seeked != 0) {
+        fclose(file);
+        return nullptr;
+    }
+    return std::unique_ptr<BlockSource>(new ThreadBlockSource(file));
+}
+
+#ifdef _WIN32
+
+// Keeps READ_AHEAD overlapped reads queued at consecutive file offsets
+class OverlappedBlockSource : public BlockSource {
+public:
+    OverlappedBlockSource(HANDLE h, uint64_t offset)
+        : hFile(h), nextReadOffset(offset), current(0), handedOut(false), atEnd(false) {
+        for (int i = 0; i < READ_AHEAD; i++) {
+            slots[i].buffer.resize(BLOCK_SIZE);
+            slots[i].overlapped = {};
+            slots[i].overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+            slots[i].pending = false;
+            Issue(slots[i]);
+        }
+    }
+
+    ~OverlappedBlockSource() override {
+        StopReading();
+        for (int i = 0; i < READ_AHEAD; i++) {
+            CloseHandle(slots[i].overlapped.hEvent);
+        }
+        CloseHandle(hFile);
+    }
+
+    bool Next(const char*& data, size_t& size) override {
+        if (handedOut) {
+            Issue(slots[current]);
+            current = (current + 1) % READ_AHEAD;
+            handedOut = false;
+        }
+
+        Slot& slot = slots[current];
+        if (!slot.pending) {
+            return false;
+        }
+        DWORD bytesRead = 0;
+        BOOL ok = GetOverlappedResult(hFile, &slot.overlapped, &bytesRead, TRUE);
+        slot.pending = false;
+        if (!ok && GetLastError() != ERROR_HANDLE_EOF) {
+            failed = true;
+        }
+        if (!ok || bytesRead == 0) {
+            StopReading();
+            return false;
+        }
+        // A short read is the end of the file as it was. The reads queued
+        // behind it may see data appended since, past the bytes this one
+        // missed, so the stream ends here as with the thread reader.
+        if (bytesRead < BLOCK_SIZE) {
+            StopReading();
+        }
+
+        data = slot.buffer.data();
+        size = bytesRead;
+        handedOut = true;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::vector<char> buffer;
+        OVERLAPPED overlapped;
+        bool pending;
+    };
+
+    // Issues no further reads and cancels the queued ones
+    void StopReading() {
+        atEnd = true;
+        CancelIo(hFile);
+        for (int i = 0; i < READ_AHEAD; i++) {
+            if (slots[i].pending) {
+                DWORD ignored = 0;
+                GetOverlappedResult(hFile, &slots[i].overlapped, &ignored, TRUE);
+                slots[i].pending = false;
+            }
+        }
+    }
+
+    void Issue(Slot& slot) {
+        if (atEnd || slot.overlapped.hEvent == NULL) {
+            return;
+        }
+        slot.overlapped.Offset = (DWORD)(nextReadOffset & 0xFFFFFFFF);
+        slot.overlapped.OffsetHigh = (DWORD)(nextReadOffset >> 32);
+        ResetEvent(slot.overlapped.hEvent);
+        if (!ReadFile(hFile, slot.buffer.data(), (DWORD)BLOCK_SIZE, NULL, &slot.overlapped) &&
+            GetLastError() != ERROR_IO_PENDING) {
+            if (GetLastError() != ERROR_HANDLE_EOF) {
+                failed = true;
+            }
+            atEnd = true;
+            return;
+        }
+        slot.pending = true;
+        nextReadOffset += BLOCK_SIZE;
+    }
+
+    HANDLE hFile;
+    Slot slots[READ_AHEAD];
+    uint64_t nextReadOffset;
+    int current;
+    bool handedOut;
+    bool atEnd;  // no further reads are issued
+};
+
+std::unique_ptr<BlockSource> OpenBlockSource(const std::string& fname, uint64_t offset) {
+    HANDLE hFile = CreateFileA(fname.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    return std::unique_ptr<BlockSource>(new OverlappedBlockSource(hFile, offset));
+}
+
+#else
+
+std::unique_ptr<BlockSource> OpenBlockSource(const std::string& fname, uint64_t offset) {
+    return OpenThreadBlockSource(fname, offset);
+}
+
+#endif
+
+LineReader::LineReader(const std::string& fname, uint64_t offset)
+    : source(OpenBlockSource(fname, offset)), block(nullptr), blockSize(0), position(0),
+      lineOffset(offset), nextOffset(offset), complete(true) {
+}
+
+bool LineReader::NextLine(std::string& line) {
+    if (!source) {
+        return false;
+    }
+
+    line.clear();
+    lineOffset = nextOffset;
+    bool any = false;
+    for (;;) {
+        if (position == blockSize) {
+            if (!source->Next(block, blockSize)) {
+                if (source->Failed()) {
+                    LOG_ERROR("Read error while scanning log");
+                }
+                blockSize = 0;
+                position = 0;
+                complete = false;
+                return any;
+            }
+            position = 0;
+        }
+
+        const char* start = block + position;
+        const char* newline = (const char*)std::memchr(start, '\n', blockSize - position);
+        size_t length = newline ? (size_t)(newline - start) : blockSize - position;
+        line.append(start, length);
+        position += length;
+        nextOffset += length;
+        any = true;
+
+        if (newline) {
+            position++;
+            nextOffset++;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            complete = true;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef BLOCKSOURCE_H
+#define BLOCKSOURCE_H
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// Sequential source of file blocks for the log scanners.
+//
+// Implementations keep several reads in flight ahead of the consumer, so
+// parsing one block overlaps with reading the next ones.
+class BlockSource {
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+    static const int READ_AHEAD = 4;
+
+    virtual ~BlockSource() {}
+
+    // Points data at the next block, which stays valid until the next call.
+    // Returns false at end of file or on a read error.
+    virtual bool Next(const char*& data, size_t& size) = 0;
+    bool Failed() const { return failed; }
+
+protected:
+    BlockSource() : failed(false) {}
+    bool failed;
+};
+
+// Opens fname for reading from offset on with the best backend of the
+// platform: overlapped I/O on Windows, a read-ahead thread elsewhere.
+// Returns nullptr if the file could not be opened.
+std::unique_ptr<BlockSource> OpenBlockSource(const std::string& fname, uint64_t offset = 0);
+// Portable backend, also used where overlapped I/O is not available
+std::unique_ptr<BlockSource> OpenThreadBlockSource(const std::string& fname, uint64_t offset = 0);
+
+// Splits the blocks of a source into lines and tracks their byte offsets.
+class LineReader {
+public:
+    LineReader(const std::string& fname, uint64_t offset = 0);
+
+    bool IsOpen() const { return source != nullptr; }
+
+    // Next line without "\n" or "\r\n". Returns false at end of file. A last
+    // line without terminator is returned with LineComplete() false.
+    bool NextLine(std::string& line);
+    bool LineComplete() const { return complete; }
+    // Offsets of the line last returned and of the one after it
+    uint64_t LineOffset() const { return lineOffset; }
+    uint64_t NextOffset() const { return nextOffset; }
+
+private:
+    std::unique_ptr<BlockSource> source;
+    const char* block;
+    size_t blockSize;
+    size_t position;
+    uint64_t lineOffset;
+    uint64_t nextOffset;
+    bool complete;
+};
+
+#endif // BLOCKSOURCE_H
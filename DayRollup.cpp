@@ -0,0 +1,368 @@
+#include "DayRollup.h"
+#include "LogParser.h"
+#include "LogArchive.h"
+#include "BlockSource.h"
+#include "LogWriter.h"
+#include "Logger.h"
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include <algorithm>
+#include <cstdio>
+
+static const char ROLLUP_MAGIC[4] = { 'T', 'R', 'R', 'U' };
+static const uint32_t ROLLUP_VERSION = 2;
+static const int FINGERPRINT_BYTES = 64;
+
+DayRollup::DayRollup()
+    : baseDay(0), dayCount(0), capacity(0), coveredOffset(0), coveredFingerprint(0), coveredOpen(false) {
+    coveredFingerprint = Fingerprint(std::string(), 0);
+}
+
+void DayRollup::Clear() {
+    baseDay = 0;
+    dayCount = 0;
+    capacity = 0;
+    minutes.clear();
+    fenwick.clear();
+    maxTree.clear();
+    coveredOffset = 0;
+    coveredFingerprint = Fingerprint(std::string(), 0);
+    coveredOpen = false;
+}
+
+void DayRollup::Resize(int newBaseDay, int newLastDay) {
+    int needed = newLastDay - newBaseDay + 1;
+    int newCapacity = 1;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+
+    std::vector<int32_t> newMinutes(newCapacity, 0);
+    for (int i = 0; i < dayCount; i++) {
+        newMinutes[baseDay + i - newBaseDay] = minutes[i];
+    }
+
+    minutes.swap(newMinutes);
+    baseDay = newBaseDay;
+    dayCount = needed;
+    capacity = newCapacity;
+    RebuildTrees();
+}
+
+void DayRollup::RebuildTrees() {
+    // Fenwick tree in O(n): every node passes its sum on to its parent
+    fenwick.assign(capacity + 1, 0);
+    for (int i = 1; i <= capacity; i++) {
+        fenwick[i] += minutes[i - 1];
+        int parent = i + (i & -i);
+        if (parent <= capacity) {
+            fenwick[parent] += fenwick[i];
+        }
+    }
+
+    // Leaves hold day indices, inner nodes the index of the larger child
+    maxTree.assign(2 * capacity, 0);
+    for (int i = 0; i < capacity; i++) {
+        maxTree[capacity + i] = i;
+    }
+    for (int node = capacity - 1; node >= 1; node--) {
+        int left = maxTree[2 * node];
+        int right = maxTree[2 * node + 1];
+        maxTree[node] = minutes[right] > minutes[left] ? right : left;
+    }
+}
+
+void DayRollup::FenwickAdd(int index, int64_t delta) {
+    for (int i = index + 1; i <= capacity; i += i & -i) {
+        fenwick[i] += delta;
+    }
+}
+
+int64_t DayRollup::FenwickPrefix(int index) const {
+    int64_t sum = 0;
+    for (int i = index; i > 0; i -= i & -i) {
+        sum += fenwick[i];
+    }
+    return sum;
+}
+
+void DayRollup::MaxTreeUpdate(int index) {
+    for (int node = (capacity + index) / 2; node >= 1; node /= 2) {
+        int left = maxTree[2 * node];
+        int right = maxTree[2 * node + 1];
+        maxTree[node] = minutes[right] > minutes[left] ? right : left;
+    }
+}
+
+int DayRollup::MaxTreeQuery(int lo, int hi) const {
+    int best = lo;
+    for (int l = lo + capacity, r = hi + capacity + 1; l < r; l /= 2, r /= 2) {
+        if (l & 1) {
+            int candidate = maxTree[l++];
+            if (minutes[candidate] > minutes[best]) best = candidate;
+        }
+        if (r & 1) {
+            int candidate = maxTree[--r];
+            if (minutes[candidate] > minutes[best]) best = candidate;
+        }
+    }
+    return best;
+}
+
+void DayRollup::Add(int day, int dayMinutes) {
+    if (dayCount == 0) {
+        Resize(day, day);
+    } else if (day < baseDay) {
+        Resize(day, LastDay());
+    } else if (day - baseDay >= capacity) {
+        Resize(baseDay, day);
+    } else if (day > LastDay()) {
+        dayCount = day - baseDay + 1;
+    }
+
+    int index = day - baseDay;
+    minutes[index] += dayMinutes;
+    FenwickAdd(index, dayMinutes);
+    MaxTreeUpdate(index);
+}
+
+int DayRollup::Minutes(int day) const {
+    if (day < baseDay || day > LastDay()) {
+        return 0;
+    }
+    return minutes[day - baseDay];
+}
+
+int64_t DayRollup::Sum(int fromDay, int toDay) const {
+    if (IsEmpty()) {
+        return 0;
+    }
+    int lo = std::max(fromDay, baseDay) - baseDay;
+    int hi = std::min(toDay, LastDay()) - baseDay;
+    if (lo > hi) {
+        return 0;
+    }
+    return FenwickPrefix(hi + 1) - FenwickPrefix(lo);
+}
+
+int64_t DayRollup::Balance(int fromDay, int toDay, int targetMinutesPerDay) const {
+    if (fromDay > toDay) {
+        return 0;
+    }
+    return Sum(fromDay, toDay) - (int64_t)targetMinutesPerDay * (toDay - fromDay + 1);
+}
+
+std::vector<DayTotal> DayRollup::TopDays(int k, int fromDay, int toDay) const {
+    std::vector<DayTotal> result;
+    if (IsEmpty() || k <= 0) {
+        return result;
+    }
+    int lo = std::max(fromDay, baseDay) - baseDay;
+    int hi = std::min(toDay, LastDay()) - baseDay;
+    if (lo > hi) {
+        return result;
+    }
+
+    // Each candidate is the maximum of a disjoint sub-range. Taking the best
+    // one splits its range in two, so k results cost O(k log n).
+    struct Candidate {
+        int index, lo, hi;
+    };
+    auto less = [this](const Candidate& a, const Candidate& b) {
+        return minutes[a.index] < minutes[b.index] ||
+               (minutes[a.index] == minutes[b.index] && a.index > b.index);
+    };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(less)> heap(less);
+    heap.push({ MaxTreeQuery(lo, hi), lo, hi });
+
+    while (!heap.empty() && (int)result.size() < k) {
+        Candidate best = heap.top();
+        heap.pop();
+        if (minutes[best.index] <= 0) {
+            break;
+        }
+        result.push_back({ baseDay + best.index, minutes[best.index] });
+        if (best.lo < best.index) {
+            heap.push({ MaxTreeQuery(best.lo, best.index - 1), best.lo, best.index - 1 });
+        }
+        if (best.index < best.hi) {
+            heap.push({ MaxTreeQuery(best.index + 1, best.hi), best.index + 1, best.hi });
+        }
+    }
+    return result;
+}
+
+uint64_t DayRollup::Fingerprint(const std::string& logName, uint64_t offset) const {
+    // FNV-1a over the bytes just before offset, enough to notice a log that
+    // was replaced or edited behind the rollup's back
+    uint64_t hash = 14695981039346656037ULL;
+    if (offset == 0 || logName.empty()) {
+        return hash;
+    }
+
+    uint64_t start = offset > FINGERPRINT_BYTES ? offset - FINGERPRINT_BYTES : 0;
+    char buffer[FINGERPRINT_BYTES];
+    std::ifstream file(logName, std::ios::binary);
+    file.seekg((std::streamoff)start);
+    file.read(buffer, (std::streamsize)(offset - start));
+    if (file.gcount() != (std::streamsize)(offset - start)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < offset - start; i++) {
+        hash ^= (unsigned char)buffer[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void DayRollup::CatchUp(const std::string& logName, const std::string& archiveName) {
+    std::ifstream file(logName, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+
+    file.seekg(0, std::ios::end);
+    uint64_t size = (uint64_t)file.tellg();
+    if (size < coveredOffset || Fingerprint(logName, coveredOffset) != coveredFingerprint) {
+        LOG_INFO("Rollup does not match " + logName + ", rebuilding");
+        Clear();
+    }
+    file.close();
+
+    SessionBuilder builder;
+    LogSession session;
+    std::string line;
+    int sessions = 0;
+
+    // Text sessions older than the archive's newest record were archived
+    // already but not yet dropped from the log
+    int64_t archivedUntil = INT64_MIN;
+    ArchiveReader archive;
+    if (!archiveName.empty() && archive.Open(archiveName)) {
+        archivedUntil = archive.LastTime();
+        if (coveredOffset == 0) {
+            Clear();
+            SessionBuilder archiveBuilder;
+            archive.ReadAll([&](const LogRecord& record) {
+                if (archiveBuilder.AddRecord(record, session)) {
+                    Add(session.day, session.minutes);
+                    sessions++;
+                }
+                return true;
+            });
+        }
+    }
+
+    LineReader reader(logName, coveredOffset);
+    bool resume = coveredOpen;
+    while (reader.NextLine(line)) {
+        // A line without terminator may still be in the middle of being written
+        if (!reader.LineComplete()) {
+            break;
+        }
+
+        // The session the last catch-up left open at a SWITCH
+        if (resume) {
+            resume = false;
+            builder.Resume(line);
+            continue;
+        }
+
+        bool wasOpen = builder.IsOpen();
+        if (builder.AddLine(line, session) &&
+            std::chrono::duration_cast<std::chrono::seconds>(session.arrive.time_since_epoch()).count() >= archivedUntil) {
+            Add(session.day, session.minutes);
+            sessions++;
+        }
+        // Resume later after the last closed session: behind a LEAVE, or at
+        // the SWITCH that started the open session
+        if (!builder.IsOpen()) {
+            coveredOffset = reader.NextOffset();
+            coveredOpen = false;
+        } else if (wasOpen && builder.Started()) {
+            coveredOffset = reader.LineOffset();
+            coveredOpen = true;
+        }
+    }
+
+    coveredFingerprint = Fingerprint(logName, coveredOffset);
+    LOG_DEBUG("Rollup caught up with " + std::to_string(sessions) + " sessions");
+}
+
+static void PutU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back((char)((value >> (8 * i)) & 0xFF));
+}
+
+static void PutU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out.push_back((char)((value >> (8 * i)) & 0xFF));
+}
+
+static uint32_t GetU32(const std::string& in, size_t pos) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)(unsigned char)in[pos + i] << (8 * i);
+    return value;
+}
+
+static uint64_t GetU64(const std::string& in, size_t pos) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= (uint64_t)(unsigned char)in[pos + i] << (8 * i);
+    return value;
+}
+
+bool DayRollup::Save(const std::string& fname) const {
+    // magic, version, base day, day count, covered offset, fingerprint,
+    // open flag, minutes
+    std::string data(ROLLUP_MAGIC, sizeof(ROLLUP_MAGIC));
+    PutU32(data, ROLLUP_VERSION);
+    PutU32(data, (uint32_t)baseDay);
+    PutU32(data, (uint32_t)dayCount);
+    PutU64(data, coveredOffset);
+    PutU64(data, coveredFingerprint);
+    PutU32(data, coveredOpen ? 1 : 0);
+    for (int i = 0; i < dayCount; i++) {
+        PutU32(data, (uint32_t)minutes[i]);
+    }
+    // Written aside and moved over fname, so a crash leaves the old or the
+    // new rollup, never a torn one
+    std::string tmpName = fname + ".tmp";
+    if (!LogWriter::ReplaceContents(tmpName, data) || !LogWriter::ReplaceFile(tmpName, fname)) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool DayRollup::Load(const std::string& fname) {
+    std::ifstream file(fname, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string data = content.str();
+
+    const size_t headerSize = 4 + 4 + 4 + 4 + 8 + 8 + 4;
+    if (data.size() < headerSize || data.compare(0, 4, ROLLUP_MAGIC, 4) != 0 ||
+        GetU32(data, 4) != ROLLUP_VERSION) {
+        return false;
+    }
+    int loadedBase = (int)GetU32(data, 8);
+    int loadedCount = (int)GetU32(data, 12);
+    if (loadedCount < 0 || data.size() != headerSize + 4 * (size_t)loadedCount) {
+        return false;
+    }
+
+    Clear();
+    if (loadedCount > 0) {
+        Resize(loadedBase, loadedBase + loadedCount - 1);
+        for (int i = 0; i < loadedCount; i++) {
+            minutes[i] = (int32_t)GetU32(data, headerSize + 4 * (size_t)i);
+        }
+        RebuildTrees();
+    }
+    coveredOffset = GetU64(data, 16);
+    coveredFingerprint = GetU64(data, 24);
+    coveredOpen = GetU32(data, 32) != 0;
+    return true;
+}
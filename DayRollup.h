@@ -0,0 +1,72 @@
+#ifndef DAYROLLUP_H
+#define DAYROLLUP_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Minutes worked on one day
+struct DayTotal {
+    int day;      // IsoCalendar day number of the local calendar date
+    int minutes;
+};
+
+// Pre-aggregated per-day minute totals of the time log.
+//
+// A Fenwick tree answers sums over any day range in O(log n), a max segment
+// tree over the same days yields the k longest days of a range in
+// O(k log n). Sessions are attributed to the day they started on, like in the
+// daily summary.
+//
+// The rollup is persisted next to the log together with the log offset it
+// covers, so only sessions closed since the last update have to be parsed.
+class DayRollup {
+public:
+    DayRollup();
+
+    void Clear();
+    void Add(int day, int dayMinutes);
+
+    bool IsEmpty() const { return dayCount == 0; }
+    int FirstDay() const { return baseDay; }
+    int LastDay() const { return baseDay + dayCount - 1; }
+    int Minutes(int day) const;
+
+    // Inclusive day ranges; days outside the rollup count as zero
+    int64_t Sum(int fromDay, int toDay) const;
+    // Worked minutes minus targetMinutesPerDay for every day of the range
+    int64_t Balance(int fromDay, int toDay, int targetMinutesPerDay) const;
+    // Longest days of the range, longest first; days without work are skipped
+    std::vector<DayTotal> TopDays(int k, int fromDay, int toDay) const;
+
+    // Adds all sessions that closed in logName after the covered offset.
+    // Starts over if the log was truncated or rewritten, replaying the
+    // archived history from archiveName first if one is given.
+    void CatchUp(const std::string& logName, const std::string& archiveName = std::string());
+
+    bool Load(const std::string& fname);
+    bool Save(const std::string& fname) const;
+
+private:
+    void Resize(int newBaseDay, int newLastDay);
+    void RebuildTrees();
+    void FenwickAdd(int index, int64_t delta);
+    int64_t FenwickPrefix(int index) const;  // sum of [0, index)
+    void MaxTreeUpdate(int index);
+    int MaxTreeQuery(int lo, int hi) const;  // index of the maximum in [lo, hi]
+    uint64_t Fingerprint(const std::string& logName, uint64_t offset) const;
+
+    int baseDay;
+    int dayCount;
+    std::vector<int32_t> minutes;  // indexed by day - baseDay, size capacity
+    std::vector<int64_t> fenwick;  // 1-based, size capacity + 1
+    std::vector<int32_t> maxTree;  // iterative segment tree, size 2 * capacity
+    int capacity;
+
+    // Log bytes already aggregated. The offset always lies between sessions.
+    uint64_t coveredOffset;
+    uint64_t coveredFingerprint;
+    bool coveredOpen;  // coveredOffset is the SWITCH of a session still open
+};
+
+#endif // DAYROLLUP_H
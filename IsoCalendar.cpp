@@ -0,0 +1,88 @@
+#include "IsoCalendar.h"
+#include <ctime>
+
+// Spot checks, evaluated by the compiler
+static_assert(IsoCalendar::DaysFromCivil(1970, 1, 1) == 0, "epoch");
+static_assert(IsoCalendar::CivilFromDays(19723).year == 2024 &&
+              IsoCalendar::CivilFromDays(19723).month == 1 &&
+              IsoCalendar::CivilFromDays(19723).day == 1, "2024-01-01");
+static_assert(IsoCalendar::Weekday(0) == 4, "1970-01-01 was a Thursday");
+static_assert(IsoCalendar::YearHas53Weeks(2020) && IsoCalendar::YearHas53Weeks(2026) &&
+              !IsoCalendar::YearHas53Weeks(2024), "53-week years");
+static_assert(IsoCalendar::IsoWeekFromDays(IsoCalendar::DaysFromCivil(2021, 1, 3)).year == 2020 &&
+              IsoCalendar::IsoWeekFromDays(IsoCalendar::DaysFromCivil(2021, 1, 3)).week == 53,
+              "2021-01-03 is in 2020-W53");
+static_assert(IsoCalendar::IsoWeekFromDays(IsoCalendar::DaysFromCivil(2024, 12, 30)).year == 2025 &&
+              IsoCalendar::IsoWeekFromDays(IsoCalendar::DaysFromCivil(2024, 12, 30)).week == 1,
+              "2024-12-30 is in 2025-W01");
+
+namespace IsoCalendar {
+
+int LocalDayNumber(const std::chrono::system_clock::time_point& tp) {
+    std::time_t tt = std::chrono::system_clock::to_time_t(tp);
+    std::tm tm = *std::localtime(&tt);
+    return DaysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+static char* PutDigits(char* out, int value, int digits) {
+    for (int i = digits - 1; i >= 0; i--) {
+        out[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return out + digits;
+}
+
+std::string DateKey(int days) {
+    CivilDate date = CivilFromDays(days);
+    char buffer[10];
+    char* p = PutDigits(buffer, date.day, 2);
+    *p++ = '.';
+    p = PutDigits(p, date.month, 2);
+    *p++ = '.';
+    p = PutDigits(p, date.year, 4);
+    return std::string(buffer, p);
+}
+
+std::string WeekKey(int days) {
+    IsoWeek week = IsoWeekFromDays(days);
+    char buffer[8];
+    char* p = PutDigits(buffer, week.year, 4);
+    *p++ = '-';
+    *p++ = 'W';
+    p = PutDigits(p, week.week, 2);
+    return std::string(buffer, p);
+}
+
+// Reads 1 to maxDigits decimal digits
+static const char* GetDigits(const char* text, int maxDigits, int& value) {
+    value = 0;
+    int digits = 0;
+    while (digits < maxDigits && text[digits] >= '0' && text[digits] <= '9') {
+        value = value * 10 + (text[digits] - '0');
+        digits++;
+    }
+    return digits > 0 ? text + digits : nullptr;
+}
+
+bool ParseIsoDate(const char* text, int& day, int& used) {
+    int year, month, dayOfMonth;
+    const char* p = GetDigits(text, 4, year);
+    if (!p || *p++ != '-' || !(p = GetDigits(p, 2, month)) || *p++ != '-' || !(p = GetDigits(p, 2, dayOfMonth)) ||
+        month < 1 || month > 12 || dayOfMonth < 1) {
+        return false;
+    }
+    // Rejects days past the end of the month
+    day = DaysFromCivil(year, month, dayOfMonth);
+    if (CivilFromDays(day).day != dayOfMonth) {
+        return false;
+    }
+    used = (int)(p - text);
+    return true;
+}
+
+bool ParseIsoDate(const std::string& text, int& day) {
+    int used;
+    return ParseIsoDate(text.c_str(), day, used) && used == (int)text.size();
+}
+
+} // namespace IsoCalendar
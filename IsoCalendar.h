@@ -0,0 +1,127 @@
+#ifndef ISOCALENDAR_H
+#define ISOCALENDAR_H
+
+#include <string>
+#include <chrono>
+
+// Calendar arithmetic on serial day numbers (days since 1970-01-01, local
+// calendar date). Everything is integer math. Dates convert in closed
+// form; the ISO week data of years 1970-2100 comes from a table computed
+// at compile time, that of other years from the same formulas at run time.
+
+struct CivilDate {
+    int year;
+    int month;  // 1..12
+    int day;    // 1..31
+};
+
+struct IsoWeek {
+    int year;   // ISO week-numbering year, may differ from the calendar year
+    int week;   // 1..53
+};
+
+namespace IsoCalendar {
+
+const int TABLE_FIRST_YEAR = 1970;
+const int TABLE_LAST_YEAR = 2100;
+
+// Proleptic Gregorian conversions (H. Hinnant's algorithms)
+constexpr int DaysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+constexpr CivilDate CivilFromDays(int days) {
+    days += 719468;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    int doe = days - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int d = doy - (153 * mp + 2) / 5 + 1;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+    return CivilDate{ yoe + era * 400 + (m <= 2), m, d };
+}
+
+// ISO weekday, 1 = Monday .. 7 = Sunday (1970-01-01 was a Thursday)
+constexpr int Weekday(int days) {
+    return ((days % 7) + 7 + 3) % 7 + 1;
+}
+
+// Monday of ISO week 1, the week that contains January 4th
+constexpr int ComputeWeek1Start(int year) {
+    int jan4 = DaysFromCivil(year, 1, 4);
+    return jan4 - (Weekday(jan4) - 1);
+}
+
+struct YearInfo {
+    int week1Start;   // day number of the Monday of ISO week 1
+    bool has53Weeks;
+};
+
+struct YearTable {
+    YearInfo years[TABLE_LAST_YEAR - TABLE_FIRST_YEAR + 2];
+
+    constexpr YearTable() : years() {
+        for (int i = 0; i < TABLE_LAST_YEAR - TABLE_FIRST_YEAR + 2; i++) {
+            int year = TABLE_FIRST_YEAR + i;
+            years[i].week1Start = ComputeWeek1Start(year);
+            years[i].has53Weeks = ComputeWeek1Start(year + 1) - ComputeWeek1Start(year) == 53 * 7;
+        }
+    }
+};
+
+// One entry per year, plus one so that week1Start(year + 1) is always there
+constexpr YearTable YEAR_TABLE = YearTable();
+
+constexpr bool InTable(int year) {
+    return year >= TABLE_FIRST_YEAR && year <= TABLE_LAST_YEAR + 1;
+}
+
+constexpr int Week1Start(int year) {
+    return InTable(year) ? YEAR_TABLE.years[year - TABLE_FIRST_YEAR].week1Start
+                         : ComputeWeek1Start(year);
+}
+
+constexpr bool YearHas53Weeks(int year) {
+    return InTable(year) && year <= TABLE_LAST_YEAR
+        ? YEAR_TABLE.years[year - TABLE_FIRST_YEAR].has53Weeks
+        : ComputeWeek1Start(year + 1) - ComputeWeek1Start(year) == 53 * 7;
+}
+
+constexpr IsoWeek IsoWeekFromDays(int days) {
+    int year = CivilFromDays(days).year;
+    if (days < Week1Start(year)) {
+        year--;
+    } else if (days >= Week1Start(year + 1)) {
+        year++;
+    }
+    return IsoWeek{ year, (days - Week1Start(year)) / 7 + 1 };
+}
+
+// Serial number of the month, year * 12 + month - 1
+constexpr int MonthIndex(int days) {
+    CivilDate date = CivilFromDays(days);
+    return date.year * 12 + date.month - 1;
+}
+
+// Day number of the local calendar date of tp
+int LocalDayNumber(const std::chrono::system_clock::time_point& tp);
+
+// "DD.MM.YYYY" and "YYYY-Www", the keys of the daily and weekly summaries
+std::string DateKey(int days);
+std::string WeekKey(int days);
+
+// Reads a "YYYY-MM-DD" date from the start of text; used gets the number of
+// characters read. Returns false unless the date exists in the calendar.
+bool ParseIsoDate(const char* text, int& day, int& used);
+// Same, but text must be the date and nothing else
+bool ParseIsoDate(const std::string& text, int& day);
+
+} // namespace IsoCalendar
+
+#endif // ISOCALENDAR_H
@@ -0,0 +1,477 @@
+#include "LogArchive.h"
+#include "LogWriter.h"
+#include "BlockSource.h"
+#include "Tags.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstdio>
+
+static const char ARCHIVE_MAGIC[4] = { 'T', 'R', 'A', 'R' };
+static const char INDEX_MAGIC[4] = { 'T', 'R', 'I', 'X' };
+static const uint32_t ARCHIVE_VERSION = 2;  // version 1 has no tags
+static const size_t HEADER_SIZE = 8;
+static const size_t BLOCK_HEADER_SIZE = 4 + 4 + 8 + 4 + 4;
+static const size_t INDEX_ENTRY_SIZE = 8 + 8 + 4;
+static const size_t FOOTER_SIZE = 4 + 8 + 4;
+
+static uint32_t Crc32(const char* data, size_t size) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void PutU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back((char)((value >> (8 * i)) & 0xFF));
+}
+
+static void PutU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out.push_back((char)((value >> (8 * i)) & 0xFF));
+}
+
+static uint32_t GetU32(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)(unsigned char)in[i] << (8 * i);
+    return value;
+}
+
+static uint64_t GetU64(const char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= (uint64_t)(unsigned char)in[i] << (8 * i);
+    return value;
+}
+
+static void PutVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+static bool GetVarint(const char*& p, const char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        unsigned char byte = (unsigned char)*p++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t ZigZag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t UnZigZag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static int64_t ToSeconds(const std::chrono::system_clock::time_point& tp) {
+    return (int64_t)std::chrono::duration_cast<std::chrono::seconds>(tp.time_since_epoch()).count();
+}
+
+static std::chrono::system_clock::time_point FromSeconds(int64_t seconds) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::seconds(seconds)));
+}
+
+ArchiveWriter::ArchiveWriter()
+    : blockRecords(0), blockFirstTime(0), blockFirstDay(0),
+      previousTime(0), previousDay(0), previousTag(TagTable::NO_TAG), lastTime(0), ok(false) {
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    if (file.is_open()) {
+        Close();
+    }
+}
+
+bool ArchiveWriter::Open(const std::string& fname) {
+    file.open(fname, std::ios::binary | std::ios::trunc);
+    ok = file.is_open();
+    if (ok) {
+        std::string header(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+        PutU32(header, ARCHIVE_VERSION);
+        file.write(header.data(), (std::streamsize)header.size());
+    }
+    return ok;
+}
+
+void ArchiveWriter::Add(const LogRecord& record) {
+    int64_t time = ToSeconds(record.time);
+    if (blockRecords == 0) {
+        blockFirstTime = time;
+        blockFirstDay = record.day;
+        previousTime = time;
+        previousDay = record.day;
+        previousTag = TagTable::NO_TAG;
+        blockTags.clear();
+    }
+
+    bool dayChanged = record.day != previousDay;
+    bool tagChanged = record.tag != previousTag;
+    PutVarint(payload, ZigZag(time - previousTime) << 5 | (uint64_t)record.kind << 2 |
+                       (tagChanged ? 2 : 0) | (dayChanged ? 1 : 0));
+    if (dayChanged) {
+        PutVarint(payload, ZigZag((int64_t)record.day - previousDay));
+    }
+    if (tagChanged) {
+        // Index into the tags of this block; a new one is followed by its name
+        size_t local = std::find(blockTags.begin(), blockTags.end(), record.tag) - blockTags.begin();
+        PutVarint(payload, local);
+        if (local == blockTags.size()) {
+            std::string name = TagTable::Name(record.tag);
+            PutVarint(payload, name.size());
+            payload.append(name);
+            blockTags.push_back(record.tag);
+        }
+    }
+
+    previousTime = time;
+    previousDay = record.day;
+    previousTag = record.tag;
+    lastTime = std::max(lastTime, time);
+    if (++blockRecords == RECORDS_PER_BLOCK) {
+        FlushBlock();
+    }
+}
+
+void ArchiveWriter::FlushBlock() {
+    if (blockRecords == 0 || !ok) {
+        return;
+    }
+
+    BlockIndex entry;
+    entry.firstTime = blockFirstTime;
+    entry.offset = (uint64_t)file.tellp();
+    entry.records = blockRecords;
+    index.push_back(entry);
+
+    std::string header;
+    PutU32(header, blockRecords);
+    PutU32(header, (uint32_t)payload.size());
+    PutU64(header, (uint64_t)blockFirstTime);
+    PutU32(header, (uint32_t)blockFirstDay);
+    PutU32(header, Crc32(payload.data(), payload.size()));
+    file.write(header.data(), (std::streamsize)header.size());
+    file.write(payload.data(), (std::streamsize)payload.size());
+    ok = file.good();
+
+    payload.clear();
+    blockRecords = 0;
+}
+
+bool ArchiveWriter::Close() {
+    FlushBlock();
+
+    std::string footer;
+    for (const BlockIndex& entry : index) {
+        PutU64(footer, (uint64_t)entry.firstTime);
+        PutU64(footer, entry.offset);
+        PutU32(footer, entry.records);
+    }
+    PutU32(footer, (uint32_t)index.size());
+    PutU64(footer, (uint64_t)lastTime);
+    footer.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    file.write(footer.data(), (std::streamsize)footer.size());
+    file.close();
+    return ok && !file.fail();
+}
+
+ArchiveReader::ArchiveReader() : version(0), lastTime(0), opened(false) {
+}
+
+bool ArchiveReader::Open(const std::string& fname) {
+    filename = fname;
+    index.clear();
+    opened = false;
+
+    std::ifstream file(fname, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    uint64_t size = (uint64_t)file.tellg();
+    if (size < HEADER_SIZE + FOOTER_SIZE) {
+        return false;
+    }
+
+    char header[HEADER_SIZE];
+    file.seekg(0);
+    file.read(header, HEADER_SIZE);
+    version = GetU32(header + 4);
+    if (std::string(header, 4) != std::string(ARCHIVE_MAGIC, 4) || version < 1 || version > ARCHIVE_VERSION) {
+        return false;
+    }
+
+    char footer[FOOTER_SIZE];
+    file.seekg((std::streamoff)(size - FOOTER_SIZE));
+    file.read(footer, FOOTER_SIZE);
+    if (std::string(footer + 12, 4) != std::string(INDEX_MAGIC, 4)) {
+        return false;
+    }
+    uint32_t blocks = GetU32(footer);
+    lastTime = (int64_t)GetU64(footer + 4);
+    if (HEADER_SIZE + FOOTER_SIZE + (uint64_t)blocks * INDEX_ENTRY_SIZE > size) {
+        return false;
+    }
+
+    std::string entries(blocks * INDEX_ENTRY_SIZE, '\0');
+    file.seekg((std::streamoff)(size - FOOTER_SIZE - entries.size()));
+    file.read(&entries[0], (std::streamsize)entries.size());
+    if (!file) {
+        return false;
+    }
+    for (uint32_t i = 0; i < blocks; i++) {
+        const char* p = entries.data() + i * INDEX_ENTRY_SIZE;
+        BlockIndex entry;
+        entry.firstTime = (int64_t)GetU64(p);
+        entry.offset = GetU64(p + 8);
+        entry.records = GetU32(p + 16);
+        index.push_back(entry);
+    }
+
+    opened = true;
+    return true;
+}
+
+size_t ArchiveReader::FindBlock(int64_t time) const {
+    // Last block that starts at or before time
+    size_t lo = 0;
+    size_t hi = index.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (index[mid].firstTime <= time) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+bool ArchiveReader::ReadBlocks(size_t firstBlock,
+                               const std::function<bool(const LogRecord&, size_t, size_t)>& onRecord) {
+    if (!opened) {
+        return false;
+    }
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string payload;
+    for (size_t block = firstBlock; block < index.size(); block++) {
+        char header[BLOCK_HEADER_SIZE];
+        file.seekg((std::streamoff)index[block].offset);
+        file.read(header, BLOCK_HEADER_SIZE);
+        if (!file) {
+            return false;
+        }
+        uint32_t records = GetU32(header);
+        uint32_t payloadSize = GetU32(header + 4);
+        int64_t time = (int64_t)GetU64(header + 8);
+        int32_t day = (int32_t)GetU32(header + 16);
+        uint32_t crc = GetU32(header + 20);
+
+        payload.resize(payloadSize);
+        file.read(&payload[0], payloadSize);
+        if (!file || Crc32(payload.data(), payload.size()) != crc) {
+            LOG_ERROR("Damaged archive block " + std::to_string(block) + " in " + filename);
+            return false;
+        }
+
+        const char* p = payload.data();
+        const char* end = p + payload.size();
+        int tagShift = version >= 2 ? 1 : 0;
+        std::vector<int> blockTags;
+        LogRecord record;
+        record.tag = TagTable::NO_TAG;
+        for (uint32_t position = 0; position < records; position++) {
+            uint64_t token;
+            if (!GetVarint(p, end, token)) {
+                return false;
+            }
+            if (token & 1) {
+                uint64_t dayDelta;
+                if (!GetVarint(p, end, dayDelta)) {
+                    return false;
+                }
+                day += (int32_t)UnZigZag(dayDelta);
+            }
+            if (tagShift && (token & 2)) {
+                uint64_t local;
+                if (!GetVarint(p, end, local) || local > blockTags.size()) {
+                    return false;
+                }
+                if (local == blockTags.size()) {
+                    uint64_t length;
+                    if (!GetVarint(p, end, length) || length > (uint64_t)(end - p)) {
+                        return false;
+                    }
+                    blockTags.push_back(TagTable::Intern(p, (size_t)length));
+                    p += length;
+                }
+                record.tag = blockTags[(size_t)local];
+            }
+            time += UnZigZag(token >> (4 + tagShift));
+            record.time = FromSeconds(time);
+            record.day = day;
+            record.kind = (LogEventKind)((token >> (1 + tagShift)) & 7);
+            if (!onRecord(record, block, position)) {
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+bool ArchiveReader::ReadAll(const std::function<bool(const LogRecord&)>& onRecord) {
+    return ReadBlocks(0, [&onRecord](const LogRecord& record, size_t, size_t) {
+        return onRecord(record);
+    });
+}
+
+// Writes the records of existing followed by records to a new archive and
+// replaces archiveName with it
+static bool WriteArchive(const std::string& archiveName, ArchiveReader& existing,
+                         const std::vector<LogRecord>& records) {
+    std::string tmpName = archiveName + ".tmp";
+    ArchiveWriter writer;
+    if (!writer.Open(tmpName)) {
+        return false;
+    }
+    if (existing.IsOpen()) {
+        if (!existing.ReadAll([&writer](const LogRecord& record) {
+                writer.Add(record);
+                return true;
+            })) {
+            writer.Close();
+            std::remove(tmpName.c_str());
+            return false;
+        }
+    }
+    for (const LogRecord& record : records) {
+        writer.Add(record);
+    }
+    if (!writer.Close()) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+
+    if (!LogWriter::ReplaceFile(tmpName, archiveName)) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ArchiveLogBefore(const std::string& logName, const std::string& archiveName, int beforeDay) {
+    LineReader reader(logName);
+    if (!reader.IsOpen()) {
+        return false;
+    }
+
+    // Records up to the archive's newest one are left over from an earlier
+    // run that was interrupted before the log was shortened
+    ArchiveReader existing;
+    int64_t archivedUntil = existing.Open(archiveName) ? existing.LastTime() : INT64_MIN;
+
+    // Find the split: the first record of beforeDay or later, moved back to
+    // the opening ARRIVE if a session is still open there
+    std::vector<LogRecord> records;
+    size_t recordsBeforeOpen = 0;
+    SessionBuilder builder;
+    LogSession session;
+    std::string line;
+    uint64_t split = 0;
+    uint64_t openOffset = 0;
+
+    while (reader.NextLine(line) && reader.LineComplete()) {
+
+        LogRecord record;
+        bool valid = LogParser::ParseLine(line, record);
+        if (valid && record.day >= beforeDay) {
+            break;
+        }
+        if (valid && ToSeconds(record.time) >= archivedUntil) {
+            bool wasOpen = builder.IsOpen();
+            builder.AddRecord(record, session);
+            if (!wasOpen && builder.IsOpen()) {
+                openOffset = reader.LineOffset();
+                recordsBeforeOpen = records.size();
+            }
+            records.push_back(record);
+        }
+        split = reader.NextOffset();
+    }
+
+    if (builder.IsOpen()) {
+        split = openOffset;
+        records.resize(recordsBeforeOpen);
+    }
+    if (split == 0) {
+        LOG_INFO("Nothing to archive before day " + std::to_string(beforeDay));
+        return true;
+    }
+
+    std::string prefix((size_t)split, '\0');
+    std::ifstream log(logName, std::ios::binary);
+    log.read(&prefix[0], (std::streamsize)split);
+    if (!log) {
+        return false;
+    }
+    log.close();
+
+    if (!records.empty() && !WriteArchive(archiveName, existing, records)) {
+        return false;
+    }
+
+    // Until the prefix is dropped, readers skip text records the archive
+    // already covers
+    if (!LogWriter::DropPrefix(logName, prefix)) {
+        LOG_WARNING("Archived records are still in " + logName);
+    }
+    LOG_INFO("Archived " + std::to_string(records.size()) + " records from " + logName);
+    return true;
+}
+
+bool ScanHistorySessions(const std::string& logName, const std::string& archiveName,
+                         const std::function<void(const LogSession&)>& onSession) {
+    ArchiveReader archive;
+    int64_t archivedUntil = INT64_MIN;
+    if (!archiveName.empty() && archive.Open(archiveName)) {
+        SessionBuilder builder;
+        LogSession session;
+        archive.ReadAll([&](const LogRecord& record) {
+            if (builder.AddRecord(record, session)) {
+                onSession(session);
+            }
+            return true;
+        });
+        archivedUntil = archive.LastTime();
+    }
+
+    return ScanLogSessions(logName, [&](const LogSession& session) {
+        if (ToSeconds(session.arrive) >= archivedUntil) {
+            onSession(session);
+        }
+    });
+}
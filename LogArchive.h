@@ -0,0 +1,111 @@
+#ifndef LOGARCHIVE_H
+#define LOGARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include "LogParser.h"
+
+// Compact binary archive for closed history of the time log.
+//
+// Layout (all integers little endian):
+//   header  "TRAR" u32 version
+//   block   u32 records, u32 payload bytes, i64 first time, i32 first day,
+//           u32 CRC-32 of payload, payload
+//   index   per block: i64 first time, u64 file offset, u32 records
+//   footer  u32 blocks, i64 last time, "TRIX"
+//
+// Each record in a payload is one LEB128 varint token
+//   zigzag(time - previous time) << 5 | event kind << 2 | tag changed << 1 |
+//   day changed
+// followed by zigzag(day - previous day) if the day changed, and by the
+// index of the tag among those of the block if the tag changed. A tag new
+// to the block also brings its name (varint length, bytes). Blocks restart
+// from their header values and the empty tag, so every block decodes on its
+// own and the index allows seeking by time. Version 1 files have no tag bit
+// and no tag fields.
+
+class ArchiveWriter {
+public:
+    static const size_t RECORDS_PER_BLOCK = 4096;
+
+    ArchiveWriter();
+    ~ArchiveWriter();
+
+    bool Open(const std::string& fname);
+    void Add(const LogRecord& record);
+    // Writes the last block, the index and the footer
+    bool Close();
+
+private:
+    void FlushBlock();
+
+    struct BlockIndex {
+        int64_t firstTime;
+        uint64_t offset;
+        uint32_t records;
+    };
+
+    std::ofstream file;
+    std::vector<BlockIndex> index;
+    std::string payload;
+    uint32_t blockRecords;
+    int64_t blockFirstTime;
+    int32_t blockFirstDay;
+    int64_t previousTime;
+    int32_t previousDay;
+    int previousTag;
+    std::vector<int> blockTags;  // tags of the current block, by local index
+    int64_t lastTime;
+    bool ok;
+};
+
+class ArchiveReader {
+public:
+    ArchiveReader();
+
+    bool Open(const std::string& fname);
+    bool IsOpen() const { return opened; }
+
+    size_t BlockCount() const { return index.size(); }
+    int64_t BlockFirstTime(size_t block) const { return index[block].firstTime; }
+    // Time stamp of the newest record, as seconds since the epoch
+    int64_t LastTime() const { return lastTime; }
+    // First block that may contain records at or after time
+    size_t FindBlock(int64_t time) const;
+
+    // Decodes records from firstBlock on and passes them with their block and
+    // position in the block. Stops when onRecord returns false. Returns false
+    // if a block is damaged.
+    bool ReadBlocks(size_t firstBlock,
+                    const std::function<bool(const LogRecord&, size_t block, size_t position)>& onRecord);
+    bool ReadAll(const std::function<bool(const LogRecord&)>& onRecord);
+
+private:
+    struct BlockIndex {
+        int64_t firstTime;
+        uint64_t offset;
+        uint32_t records;
+    };
+
+    std::string filename;
+    std::vector<BlockIndex> index;
+    uint32_t version;
+    int64_t lastTime;
+    bool opened;
+};
+
+// Moves the records of days before beforeDay from the text log into the
+// archive. The split is moved back so that no session spans it. Existing
+// archive content is kept. Returns false and leaves both files unchanged on
+// failure.
+bool ArchiveLogBefore(const std::string& logName, const std::string& archiveName, int beforeDay);
+
+// Reports every closed session of the archive (if present) and then of the
+// text log, as one continuous history.
+bool ScanHistorySessions(const std::string& logName, const std::string& archiveName,
+                         const std::function<void(const LogSession&)>& onSession);
+
+#endif // LOGARCHIVE_H
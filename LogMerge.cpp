@@ -0,0 +1,175 @@
+#include "LogMerge.h"
+#include "LogWriter.h"
+#include "BlockSource.h"
+#include "IsoCalendar.h"
+#include "Tags.h"
+#include "Logger.h"
+#include <queue>
+#include <memory>
+#include <fstream>
+#include <cstdio>
+
+// Sessions of one log, one at a time
+class SessionCursor {
+public:
+    SessionCursor(const MergeSource& source)
+        : reader(source.fname), offset(std::chrono::seconds(source.clockOffsetSeconds)) {}
+
+    bool IsOpen() const { return reader.IsOpen(); }
+
+    bool Next(LogSession& session) {
+        std::string line;
+        while (reader.NextLine(line)) {
+            if (builder.AddLine(line, session)) {
+                if (offset.count() != 0) {
+                    session.arrive += offset;
+                    session.leave += offset;
+                    session.day = IsoCalendar::LocalDayNumber(session.arrive);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    LineReader reader;
+    SessionBuilder builder;
+    std::chrono::seconds offset;
+};
+
+struct MergeHead {
+    LogSession session;
+    size_t source;
+};
+
+// Earliest arrive on top; ties go to the earlier source
+struct MergeHeadLater {
+    bool operator()(const MergeHead& a, const MergeHead& b) const {
+        return a.session.arrive > b.session.arrive ||
+               (a.session.arrive == b.session.arrive && a.source > b.source);
+    }
+};
+
+static void SetArrive(LogSession& session, const std::chrono::system_clock::time_point& arrive) {
+    session.arrive = arrive;
+    session.day = IsoCalendar::LocalDayNumber(arrive);
+}
+
+static void UpdateMinutes(LogSession& session) {
+    session.minutes = (int)std::chrono::duration_cast<std::chrono::minutes>(session.leave - session.arrive).count();
+}
+
+bool MergeLogSessions(const std::vector<MergeSource>& sources,
+                      const std::function<void(const LogSession&)>& onSession) {
+    std::vector<std::unique_ptr<SessionCursor>> cursors;
+    std::priority_queue<MergeHead, std::vector<MergeHead>, MergeHeadLater> heap;
+    for (size_t i = 0; i < sources.size(); i++) {
+        cursors.emplace_back(new SessionCursor(sources[i]));
+        if (!cursors.back()->IsOpen()) {
+            LOG_ERROR("Could not open " + sources[i].fname + " for merging");
+            return false;
+        }
+        MergeHead head;
+        head.source = i;
+        if (cursors[i]->Next(head.session)) {
+            heap.push(head);
+        }
+    }
+
+    LogSession current;
+    bool hasCurrent = false;
+    auto emit = [&]() {
+        UpdateMinutes(current);
+        if (current.minutes > 0) {
+            onSession(current);
+        }
+    };
+
+    while (!heap.empty()) {
+        MergeHead head = heap.top();
+        heap.pop();
+        LogSession next = head.session;
+        if (cursors[head.source]->Next(head.session)) {
+            heap.push(head);
+        }
+
+        if (!hasCurrent) {
+            current = next;
+            hasCurrent = true;
+            continue;
+        }
+
+        // Time up to current.leave is counted already. Clipping against it
+        // also keeps a log whose clock jumped back from counting twice.
+        if (next.leave <= current.leave) {
+            continue;
+        }
+        if (next.arrive <= current.leave && next.tag == current.tag) {
+            current.leave = next.leave;
+            current.leaveKind = next.leaveKind;
+            continue;
+        }
+        if (next.arrive < current.leave) {
+            SetArrive(next, current.leave);
+        }
+        emit();
+        current = next;
+    }
+    if (hasCurrent) {
+        emit();
+    }
+    return true;
+}
+
+bool WriteMergedLog(const std::vector<MergeSource>& sources, const std::string& outName) {
+    for (const MergeSource& source : sources) {
+        if (source.fname == outName) {
+            LOG_ERROR("Merged log must not overwrite " + outName);
+            return false;
+        }
+    }
+
+    // Written next to the target first, so a failed merge leaves no partial log
+    std::string tmpName = outName + ".tmp";
+    std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    bool ok = MergeLogSessions(sources, [&out](const LogSession& session) {
+        LogRecord record;
+        record.time = session.arrive;
+        record.day = session.day;
+        record.kind = LogEventKind::Arrive;
+        record.tag = session.tag;
+        out << LogParser::FormatRecord(record) << LOG_LINE_END;
+
+        // A bare SWITCH would reopen the session untagged on the next parse
+        record.time = session.leave;
+        record.kind = session.leaveKind == LogEventKind::Switch ? LogEventKind::Leave : session.leaveKind;
+        record.tag = TagTable::NO_TAG;
+        out << LogParser::FormatRecord(record) << LOG_LINE_END;
+    });
+    out.close();
+
+    if (!ok || out.fail()) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    if (!LogWriter::ReplaceFile(tmpName, outName)) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MergeSummary(const std::vector<MergeSource>& sources, SummaryGrouping grouping,
+                  const SummaryWindow& window, const SummaryStream::RowCallback& onRow) {
+    SummaryStream stream(grouping, window, onRow);
+    bool ok = MergeLogSessions(sources, [&stream](const LogSession& session) {
+        stream.AddSession(session);
+    });
+    stream.Finish();
+    return ok;
+}
@@ -0,0 +1,42 @@
+#ifndef LOGMERGE_H
+#define LOGMERGE_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "LogParser.h"
+#include "SummaryStream.h"
+
+// One device's time log
+struct MergeSource {
+    std::string fname;
+    int clockOffsetSeconds;  // added to every time stamp, corrects clock skew
+
+    MergeSource(const std::string& name, int offsetSeconds = 0)
+        : fname(name), clockOffsetSeconds(offsetSeconds) {}
+};
+
+// Merges the sessions of several devices' logs so overlapping time counts
+// once.
+//
+// Every log is chronological, so the next session of each is the only one
+// held in memory: a min-heap of the N current sessions yields all sessions
+// in arrive order. A session is clipped to start where the merged time so far
+// ends; what remains extends the current merged session if the tag is the
+// same, and starts a new one otherwise. Open sessions at the end of a log are
+// not counted, as in the summaries.
+//
+// Returns false if a log could not be opened; nothing is reported then.
+bool MergeLogSessions(const std::vector<MergeSource>& sources,
+                      const std::function<void(const LogSession&)>& onSession);
+
+// Writes the merged sessions as tagged ARRIVE and LEAVE pairs to outName,
+// which must not be one of the sources. Sessions ended by a SWITCH get a
+// plain LEAVE, so every session keeps its tag when the log is read again.
+bool WriteMergedLog(const std::vector<MergeSource>& sources, const std::string& outName);
+
+// Summary rows of the merged sessions, without writing a merged log
+bool MergeSummary(const std::vector<MergeSource>& sources, SummaryGrouping grouping,
+                  const SummaryWindow& window, const SummaryStream::RowCallback& onRow);
+
+#endif // LOGMERGE_H
@@ -0,0 +1,315 @@
+#include "LogParser.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "IsoCalendar.h"
+#include "BlockSource.h"
+#include "Tags.h"
+#include <sstream>
+#include <ctime>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+std::chrono::system_clock::time_point LogParser::ParseTime(const std::string& line, int* dayNumber) {
+    METRICS_SCOPED_TIMER(TIMER_PARSE);
+
+    // Parse format: DD.MM.YYYY,HH:MM:SS,EVENT
+    // Find the second comma to get the datetime part
+    size_t firstComma = line.find(',');
+    size_t secondComma = line.find(',', firstComma + 1);
+
+    if (firstComma == std::string::npos || secondComma == std::string::npos) {
+        METRICS_COUNT(COUNTER_PARSE_ERRORS, 1);
+        LOG_WARNING("Invalid line format - missing commas: " + line);
+        return std::chrono::system_clock::time_point{}; // Return epoch time on error
+    }
+
+    // Parse the date part (DD.MM.YYYY)
+    std::string datePart = line.substr(0, firstComma);
+    std::string timePart = line.substr(firstComma + 1, secondComma - firstComma - 1);
+
+    LOG_TRACE("Date part: " + datePart + ", Time part: " + timePart);
+
+    std::tm tm = {};
+
+    // Parse date: DD.MM.YYYY
+    std::istringstream dateStream(datePart);
+    char dot1, dot2;
+    int day, month, year;
+    dateStream >> day >> dot1 >> month >> dot2 >> year;
+
+    if (dateStream.fail() || dot1 != '.' || dot2 != '.') {
+        METRICS_COUNT(COUNTER_PARSE_ERRORS, 1);
+        LOG_WARNING("Failed to parse date components: " + datePart);
+        return std::chrono::system_clock::time_point{};
+    }
+
+    // Parse time: HH:MM:SS
+    std::istringstream timeStream(timePart);
+    char colon1, colon2;
+    int hour, minute, second;
+    timeStream >> hour >> colon1 >> minute >> colon2 >> second;
+
+    if (timeStream.fail() || colon1 != ':' || colon2 != ':') {
+        METRICS_COUNT(COUNTER_PARSE_ERRORS, 1);
+        LOG_WARNING("Failed to parse time components: " + timePart);
+        return std::chrono::system_clock::time_point{};
+    }
+
+    // Set tm structure
+    tm.tm_mday = day;
+    tm.tm_mon = month - 1;  // months are 0-based
+    tm.tm_year = year - 1900;  // years since 1900
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    tm.tm_isdst = -1; // Let system determine DST
+
+    auto time_t_val = std::mktime(&tm);
+    if (time_t_val == -1) {
+        METRICS_COUNT(COUNTER_PARSE_ERRORS, 1);
+        LOG_WARNING("mktime failed for: " + datePart + " " + timePart);
+        return std::chrono::system_clock::time_point{}; // Return epoch time on error
+    }
+
+    if (dayNumber) {
+        *dayNumber = IsoCalendar::DaysFromCivil(year, month, day);
+    }
+    return std::chrono::system_clock::from_time_t(time_t_val);
+}
+
+LogEventKind LogParser::ParseEventKind(const std::string& line) {
+    size_t firstComma = line.find(',');
+    size_t secondComma = firstComma == std::string::npos ? std::string::npos : line.find(',', firstComma + 1);
+    if (secondComma == std::string::npos) {
+        return LogEventKind::Unknown;
+    }
+
+    // Only the event field; a tag after it must not change the kind
+    const char* event = line.c_str() + secondComma + 1;
+    const char* tagComma = std::strchr(event, ',');
+    size_t length = tagComma ? (size_t)(tagComma - event) : std::strlen(event);
+    auto has = [event, length](const char* word) {
+        return std::search(event, event + length, word, word + std::strlen(word)) != event + length;
+    };
+
+    if (std::strncmp(event, "ARRIVE", 6) == 0) {
+        return has("hibernation") ? LogEventKind::ArriveHibernation : LogEventKind::Arrive;
+    }
+    if (std::strncmp(event, "LEAVE", 5) == 0) {
+        if (has("hibernation")) return LogEventKind::LeaveHibernation;
+        if (has("closed")) return LogEventKind::LeaveClosed;
+        if (has("terminated")) return LogEventKind::LeaveTerminated;
+        return LogEventKind::Leave;
+    }
+    if (std::strncmp(event, "SWITCH", 6) == 0) {
+        return LogEventKind::Switch;
+    }
+    return LogEventKind::Unknown;
+}
+
+bool LogParser::ParseDay(const std::string& line, int& day) {
+    if (line.size() < 10 || line[2] != '.' || line[5] != '.') {
+        return false;
+    }
+    int digits[8];
+    const int positions[8] = { 0, 1, 3, 4, 6, 7, 8, 9 };
+    for (int i = 0; i < 8; i++) {
+        char c = line[positions[i]];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        digits[i] = c - '0';
+    }
+    day = IsoCalendar::DaysFromCivil(digits[4] * 1000 + digits[5] * 100 + digits[6] * 10 + digits[7],
+                                     digits[2] * 10 + digits[3], digits[0] * 10 + digits[1]);
+    return true;
+}
+
+int LogParser::ParseTag(const std::string& line) {
+    size_t comma = line.find(',');
+    for (int i = 0; i < 2 && comma != std::string::npos; i++) {
+        comma = line.find(',', comma + 1);
+    }
+    if (comma == std::string::npos) {
+        return TagTable::NO_TAG;
+    }
+    size_t length = line.size() - comma - 1;
+    if (length > 0 && line.back() == '\r') {
+        length--;
+    }
+    return TagTable::Intern(line.data() + comma + 1, length);
+}
+
+bool LogParser::ParseLine(const std::string& line, LogRecord& record) {
+    record.kind = ParseEventKind(line);
+    if (record.kind == LogEventKind::Unknown) {
+        return false;
+    }
+    record.tag = ParseTag(line);
+    record.time = ParseTime(line, &record.day);
+    return record.time != std::chrono::system_clock::time_point{};
+}
+
+const char* LogParser::EventText(LogEventKind kind) {
+    switch (kind) {
+        case LogEventKind::Arrive: return "ARRIVE";
+        case LogEventKind::ArriveHibernation: return "ARRIVE (from hibernation)";
+        case LogEventKind::Leave: return "LEAVE";
+        case LogEventKind::LeaveHibernation: return "LEAVE (app hibernation)";
+        case LogEventKind::LeaveClosed: return "LEAVE (app closed)";
+        case LogEventKind::LeaveTerminated: return "LEAVE (app forcefully terminated)";
+        case LogEventKind::Switch: return "SWITCH";
+        default: return "";
+    }
+}
+
+std::string LogParser::FormatRecord(const LogRecord& record) {
+    std::time_t tt = std::chrono::system_clock::to_time_t(record.time);
+    std::tm tm = *std::localtime(&tt);
+    char buffer[80];
+    std::snprintf(buffer, sizeof(buffer), "%02d.%02d.%04d,%02d:%02d:%02d,",
+                  tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+    std::string line = buffer;
+    line += EventText(record.kind);
+    if (record.tag != TagTable::NO_TAG) {
+        line += "," + TagTable::Name(record.tag);
+    }
+    return line;
+}
+
+bool LogParser::IsArrive(LogEventKind kind) {
+    return kind == LogEventKind::Arrive || kind == LogEventKind::ArriveHibernation;
+}
+
+bool LogParser::IsLeave(LogEventKind kind) {
+    return kind == LogEventKind::Leave || kind == LogEventKind::LeaveHibernation ||
+           kind == LogEventKind::LeaveClosed || kind == LogEventKind::LeaveTerminated;
+}
+
+std::string LogParser::DateKey(const std::chrono::system_clock::time_point& tp) {
+    return IsoCalendar::DateKey(IsoCalendar::LocalDayNumber(tp));
+}
+
+std::string LogParser::WeekKey(const std::chrono::system_clock::time_point& tp) {
+    return IsoCalendar::WeekKey(IsoCalendar::LocalDayNumber(tp));
+}
+
+bool SessionBuilder::Close(const std::chrono::system_clock::time_point& leaveTime, LogEventKind leaveKind,
+                           LogSession& session) {
+    auto duration = std::chrono::duration_cast<std::chrono::minutes>(leaveTime - arriveTime).count();
+    arrived = false;
+
+    // Only count positive durations
+    if (duration <= 0) {
+        return false;
+    }
+    session.arrive = arriveTime;
+    session.leave = leaveTime;
+    session.day = arriveDay;
+    session.minutes = (int)duration;
+    session.leaveKind = leaveKind;
+    session.tag = arriveTag;
+    METRICS_COUNT(COUNTER_SESSIONS, 1);
+    return true;
+}
+
+bool SessionBuilder::AddLine(const std::string& line, LogSession& session) {
+    LogEventKind kind = LogParser::ParseEventKind(line);
+    auto epoch = std::chrono::system_clock::time_point{};
+    started = false;
+
+    if (LogParser::IsArrive(kind) && !arrived) {
+        int day = 0;
+        auto t = LogParser::ParseTime(line, &day);
+        if (t != epoch) {
+            Open(t, day, LogParser::ParseTag(line));
+        }
+    } else if (LogParser::IsLeave(kind) && arrived) {
+        auto t = LogParser::ParseTime(line);
+        if (t != epoch) {
+            return Close(t, kind, session);
+        }
+    } else if (kind == LogEventKind::Switch && arrived) {
+        int day = 0;
+        auto t = LogParser::ParseTime(line, &day);
+        if (t != epoch) {
+            return Switch(t, day, LogParser::ParseTag(line), session);
+        }
+    }
+    return false;
+}
+
+bool SessionBuilder::AddRecord(const LogRecord& record, LogSession& session) {
+    started = false;
+    if (LogParser::IsArrive(record.kind) && !arrived) {
+        Open(record.time, record.day, record.tag);
+    } else if (LogParser::IsLeave(record.kind) && arrived) {
+        return Close(record.time, record.kind, session);
+    } else if (record.kind == LogEventKind::Switch && arrived) {
+        return Switch(record.time, record.day, record.tag, session);
+    }
+    return false;
+}
+
+bool SessionBuilder::Resume(const std::string& line) {
+    LogRecord record;
+    return LogParser::ParseLine(line, record) && Resume(record);
+}
+
+bool SessionBuilder::Resume(const LogRecord& record) {
+    started = false;
+    if (!LogParser::IsArrive(record.kind) && record.kind != LogEventKind::Switch) {
+        return false;
+    }
+    Open(record.time, record.day, record.tag);
+    return true;
+}
+
+bool SessionBuilder::Switch(const std::chrono::system_clock::time_point& time, int day, int tag,
+                            LogSession& session) {
+    bool closed = Close(time, LogEventKind::Switch, session);
+    Open(time, day, tag);
+    return closed;
+}
+
+void SessionBuilder::Open(const std::chrono::system_clock::time_point& time, int day, int tag) {
+    arriveTime = time;
+    arriveDay = day;
+    arriveTag = tag;
+    arrived = true;
+    started = true;
+}
+
+bool ScanLogSessions(const std::string& fname,
+                     const std::function<void(const LogSession&)>& onSession) {
+    LineReader file(fname);
+    if (!file.IsOpen()) {
+        LOG_DEBUG("Could not open log file: " + fname);
+        return false;
+    }
+
+    LOG_DEBUG("Starting to parse log file: " + fname);
+
+    SessionBuilder builder;
+    LogSession session;
+    std::string line;
+    int totalLines = 0;
+    int sessions = 0;
+
+    while (file.NextLine(line)) {
+        totalLines++;
+        METRICS_COUNT(COUNTER_LINES_READ, 1);
+        LOG_TRACE("Processing line " + std::to_string(totalLines) + ": " + line);
+
+        if (builder.AddLine(line, session)) {
+            sessions++;
+            onSession(session);
+        }
+    }
+
+    LOG_DEBUG("Parsed " + fname + ": Total lines: " + std::to_string(totalLines) +
+              ", Sessions: " + std::to_string(sessions));
+    return true;
+}
@@ -0,0 +1,111 @@
+#ifndef LOGPARSER_H
+#define LOGPARSER_H
+
+#include <string>
+#include <chrono>
+#include <functional>
+
+// Platform-neutral parsing of Timelog.txt.
+//
+// Line format: DD.MM.YYYY,HH:MM:SS,EVENT[,TAG]
+// EVENT is one of the texts of EventText, e.g. "ARRIVE" or
+// "LEAVE (app hibernation)". ARRIVE and SWITCH may name the project tag the
+// following time is booked on; lines without one read as before.
+
+enum class LogEventKind {
+    Unknown,
+    Arrive,
+    ArriveHibernation,
+    Leave,
+    LeaveHibernation,
+    LeaveClosed,
+    LeaveTerminated,
+    Switch  // change of project tag while present
+};
+
+struct LogRecord {
+    std::chrono::system_clock::time_point time;
+    int day;  // local calendar date as IsoCalendar day number
+    LogEventKind kind;
+    int tag;  // TagTable ID, NO_TAG if the line has none
+};
+
+// One ARRIVE..LEAVE interval with a positive duration
+struct LogSession {
+    std::chrono::system_clock::time_point arrive;
+    std::chrono::system_clock::time_point leave;
+    int day;  // local calendar date of arrive as IsoCalendar day number
+    int minutes;
+    LogEventKind leaveKind;
+    int tag;  // TagTable ID of the ARRIVE or SWITCH that started it
+};
+
+class LogParser {
+public:
+    // Returns epoch time if the line has no valid date and time. The day
+    // number is taken from the date text directly, without time zone math.
+    static std::chrono::system_clock::time_point ParseTime(const std::string& line, int* day = nullptr);
+    static LogEventKind ParseEventKind(const std::string& line);
+    // Day number of the date at the start of the line, without parsing the
+    // rest. Returns false if the line does not start with DD.MM.YYYY.
+    static bool ParseDay(const std::string& line, int& day);
+    // Interned tag of the line, NO_TAG if it has none
+    static int ParseTag(const std::string& line);
+    static bool ParseLine(const std::string& line, LogRecord& record);
+
+    // Event text written to the log for kind, the same in every language
+    static const char* EventText(LogEventKind kind);
+    // Log line of record in local time, without line terminator
+    static std::string FormatRecord(const LogRecord& record);
+
+    static bool IsArrive(LogEventKind kind);
+    static bool IsLeave(LogEventKind kind);
+
+    // Summary keys: "DD.MM.YYYY" and "YYYY-Www"
+    static std::string DateKey(const std::chrono::system_clock::time_point& tp);
+    static std::string WeekKey(const std::chrono::system_clock::time_point& tp);
+};
+
+// Pairs ARRIVE and LEAVE records into sessions.
+// Repeated ARRIVEs keep the first one, LEAVEs without ARRIVE are ignored and
+// sessions of less than one minute are dropped, as the summaries always did.
+// A SWITCH closes the open session and starts one with the new tag.
+class SessionBuilder {
+public:
+    SessionBuilder() : arrived(false), started(false), arriveDay(0), arriveTag(0) {}
+
+    // Returns true if the line closed a session. The time stamp is only
+    // parsed when the event changes the state.
+    bool AddLine(const std::string& line, LogSession& session);
+    bool AddRecord(const LogRecord& record, LogSession& session);
+    // Opens the session an ARRIVE or SWITCH starts, also when one is open
+    // already, for scans that begin in the middle of the log. Returns false
+    // if the line or record starts no session.
+    bool Resume(const std::string& line);
+    bool Resume(const LogRecord& record);
+
+    bool IsOpen() const { return arrived; }
+    // True if the last line or record started a session, SWITCH included
+    bool Started() const { return started; }
+    std::chrono::system_clock::time_point OpenSince() const { return arriveTime; }
+    int OpenTag() const { return arriveTag; }
+
+private:
+    bool Close(const std::chrono::system_clock::time_point& leaveTime, LogEventKind leaveKind,
+               LogSession& session);
+    bool Switch(const std::chrono::system_clock::time_point& time, int day, int tag, LogSession& session);
+    void Open(const std::chrono::system_clock::time_point& time, int day, int tag);
+
+    bool arrived;
+    bool started;
+    std::chrono::system_clock::time_point arriveTime;
+    int arriveDay;
+    int arriveTag;
+};
+
+// Reads fname line by line and reports every closed session.
+// Returns false if the file could not be opened.
+bool ScanLogSessions(const std::string& fname,
+                     const std::function<void(const LogSession&)>& onSession);
+
+#endif // LOGPARSER_H
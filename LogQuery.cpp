@@ -0,0 +1,238 @@
+#include "LogQuery.h"
+#include "LogArchive.h"
+#include "BlockSource.h"
+#include "IsoCalendar.h"
+#include "Logger.h"
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+SessionFilter::SessionFilter()
+    : fromDay(INT_MIN), toDay(INT_MAX), weekdays(ALL_WEEKDAYS),
+      fromMinute(0), toMinute(MINUTES_PER_DAY), leaveKinds(~0u) {
+}
+
+bool SessionFilter::IsUnfiltered() const {
+    return fromDay == INT_MIN && toDay == INT_MAX && weekdays == ALL_WEEKDAYS &&
+           fromMinute == 0 && toMinute == MINUTES_PER_DAY && leaveKinds == ~0u;
+}
+
+bool SessionFilter::AcceptsDay(int day) const {
+    return day >= fromDay && day <= toDay &&
+           (weekdays & (1u << (IsoCalendar::Weekday(day) - 1))) != 0;
+}
+
+bool SessionFilter::Apply(LogSession& session) const {
+    if (!AcceptsDay(session.day) || !(leaveKinds & KindBit(session.leaveKind))) {
+        return false;
+    }
+    if (fromMinute == 0 && toMinute == MINUTES_PER_DAY) {
+        return true;
+    }
+
+    // Seconds since midnight of the arrive day; a session past midnight
+    // meets the window again on the following days
+    std::time_t tt = std::chrono::system_clock::to_time_t(session.arrive);
+    std::tm tm = *std::localtime(&tt);
+    int64_t start = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    int64_t end = start + std::chrono::duration_cast<std::chrono::seconds>(session.leave - session.arrive).count();
+
+    int64_t inside = 0;
+    for (int64_t dayStart = 0; dayStart < end; dayStart += MINUTES_PER_DAY * 60) {
+        int64_t from = std::max(start, dayStart + fromMinute * 60);
+        int64_t to = std::min(end, dayStart + toMinute * 60);
+        if (to > from) {
+            inside += to - from;
+        }
+    }
+
+    session.minutes = (int)(inside / 60);
+    return session.minutes > 0;
+}
+
+bool SessionFilter::ParseOption(const std::string& arg) {
+    if (arg.find("--from=") == 0) {
+        return IsoCalendar::ParseIsoDate(arg.substr(7), fromDay);
+    }
+    if (arg.find("--to=") == 0) {
+        return IsoCalendar::ParseIsoDate(arg.substr(5), toDay);
+    }
+
+    if (arg.find("--weekdays=") == 0) {
+        // Comma separated weekdays or ranges, e.g. "1-5" or "1,3,5"
+        unsigned mask = 0;
+        const char* p = arg.c_str() + 11;
+        while (*p) {
+            int first, last, used = 0;
+            if (std::sscanf(p, "%d-%d%n", &first, &last, &used) != 2) {
+                used = 0;
+                if (std::sscanf(p, "%d%n", &first, &used) != 1) {
+                    return false;
+                }
+                last = first;
+            }
+            if (first < 1 || last > 7 || first > last) {
+                return false;
+            }
+            for (int d = first; d <= last; d++) {
+                mask |= 1u << (d - 1);
+            }
+            p += used;
+            if (*p == ',') {
+                p++;
+            }
+        }
+        weekdays = mask;
+        return mask != 0;
+    }
+
+    if (arg.find("--hours=") == 0) {
+        int h1, m1, h2, m2;
+        if (std::sscanf(arg.c_str() + 8, "%d:%d-%d:%d", &h1, &m1, &h2, &m2) != 4 ||
+            h1 < 0 || m1 < 0 || m1 > 59 || h2 < 0 || m2 < 0 || m2 > 59 ||
+            h1 * 60 + m1 >= h2 * 60 + m2 || h2 * 60 + m2 > MINUTES_PER_DAY) {
+            return false;
+        }
+        fromMinute = h1 * 60 + m1;
+        toMinute = h2 * 60 + m2;
+        return true;
+    }
+
+    if (arg.find("--exclude-leave=") == 0) {
+        std::string kind = arg.substr(16);
+        if (kind == "terminated") leaveKinds &= ~KindBit(LogEventKind::LeaveTerminated);
+        else if (kind == "hibernation") leaveKinds &= ~KindBit(LogEventKind::LeaveHibernation);
+        else if (kind == "closed") leaveKinds &= ~KindBit(LogEventKind::LeaveClosed);
+        else if (kind == "manual") leaveKinds &= ~KindBit(LogEventKind::Leave);
+        else return false;
+        return true;
+    }
+    return false;
+}
+
+// Local midnight starting day, as seconds since the epoch
+static int64_t DayStartTime(int day) {
+    CivilDate date = IsoCalendar::CivilFromDays(day);
+    std::tm tm = {};
+    tm.tm_year = date.year - 1900;
+    tm.tm_mon = date.month - 1;
+    tm.tm_mday = date.day;
+    tm.tm_isdst = -1;
+    return (int64_t)std::mktime(&tm);
+}
+
+uint64_t FindDayOffset(const std::string& logName, int day) {
+    std::ifstream file(logName, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+    file.seekg(0, std::ios::end);
+    uint64_t size = (uint64_t)file.tellg();
+
+    // Start of the first dated line at or after pos, and its day
+    std::string line;
+    auto probe = [&](uint64_t pos, int& lineDay) -> uint64_t {
+        file.clear();
+        file.seekg((std::streamoff)(pos > 0 ? pos - 1 : 0));
+        uint64_t start = pos > 0 ? pos - 1 : 0;
+        if (pos > 0) {
+            std::getline(file, line);
+            start += line.size() + 1;
+        }
+        while (start < size && std::getline(file, line)) {
+            if (LogParser::ParseDay(line, lineDay)) {
+                return start;
+            }
+            start += line.size() + 1;
+        }
+        return size;
+    };
+
+    // Smallest pos whose next dated line is of day or later
+    uint64_t lo = 0;
+    uint64_t hi = size;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        int lineDay = 0;
+        if (probe(mid, lineDay) == size || lineDay >= day) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    int lineDay = 0;
+    return probe(lo, lineDay);
+}
+
+bool ScanFilteredSessions(const std::string& logName, const std::string& archiveName,
+                          const SessionFilter& filter,
+                          const std::function<void(const LogSession&)>& onSession) {
+    LogSession session;
+    int64_t archivedUntil = INT64_MIN;
+
+    ArchiveReader archive;
+    if (!archiveName.empty() && archive.Open(archiveName)) {
+        archivedUntil = archive.LastTime();
+        // A block that starts before the range begins with sessions that
+        // also started before it, so skipping its predecessors loses nothing
+        size_t firstBlock = filter.fromDay == INT_MIN ? 0 : archive.FindBlock(DayStartTime(filter.fromDay));
+        SessionBuilder builder;
+        bool first = firstBlock > 0;
+        archive.ReadBlocks(firstBlock, [&](const LogRecord& record, size_t, size_t) {
+            if (record.day > filter.toDay && !builder.IsOpen()) {
+                return false;
+            }
+            // The block may begin with a SWITCH in a session of an earlier
+            // block, as the text log below may at the first line of the range
+            if (first) {
+                first = false;
+                if (record.kind == LogEventKind::Switch && builder.Resume(record)) {
+                    return true;
+                }
+            }
+            if (builder.AddRecord(record, session) && filter.Apply(session)) {
+                onSession(session);
+            }
+            return true;
+        });
+
+        // The whole range lies in the archive
+        if (filter.toDay != INT_MAX &&
+            IsoCalendar::LocalDayNumber(std::chrono::system_clock::from_time_t((std::time_t)archivedUntil)) > filter.toDay) {
+            return true;
+        }
+    }
+
+    uint64_t offset = filter.fromDay == INT_MIN ? 0 : FindDayOffset(logName, filter.fromDay);
+    LineReader reader(logName, offset);
+    if (!reader.IsOpen()) {
+        return false;
+    }
+
+    SessionBuilder builder;
+    std::string line;
+    int day = 0;
+    bool first = offset > 0;
+    while (reader.NextLine(line)) {
+        // Only the date is looked at once the range is passed
+        if (!builder.IsOpen() && LogParser::ParseDay(line, day) && day > filter.toDay) {
+            break;
+        }
+        // The range may begin with a SWITCH in a session of the day before;
+        // the session it starts belongs to the range
+        if (first) {
+            first = false;
+            if (LogParser::ParseEventKind(line) == LogEventKind::Switch && builder.Resume(line)) {
+                continue;
+            }
+        }
+        if (builder.AddLine(line, session) &&
+            std::chrono::duration_cast<std::chrono::seconds>(session.arrive.time_since_epoch()).count() >= archivedUntil &&
+            filter.Apply(session)) {
+            onSession(session);
+        }
+    }
+    return true;
+}
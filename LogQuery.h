@@ -0,0 +1,53 @@
+#ifndef LOGQUERY_H
+#define LOGQUERY_H
+
+#include <string>
+#include <cstdint>
+#include <climits>
+#include <functional>
+#include "LogParser.h"
+
+// Which sessions a summary counts, and which part of each.
+// A default constructed filter accepts everything.
+struct SessionFilter {
+    static const unsigned ALL_WEEKDAYS = 0x7F;
+    static const int MINUTES_PER_DAY = 24 * 60;
+
+    int fromDay;          // inclusive IsoCalendar day number, INT_MIN = open
+    int toDay;            // inclusive, INT_MAX = open
+    unsigned weekdays;    // bit Weekday(day) - 1 for every accepted weekday
+    int fromMinute;       // time-of-day window [fromMinute, toMinute) in
+    int toMinute;         // local minutes since midnight
+    unsigned leaveKinds;  // KindBit() of every event that may end a session
+
+    SessionFilter();
+
+    static unsigned KindBit(LogEventKind kind) { return 1u << (int)kind; }
+
+    bool IsUnfiltered() const;
+    bool AcceptsDay(int day) const;
+    // Checks the session against all filters and clips its minutes to the
+    // time-of-day window. Returns false if nothing of it is left.
+    bool Apply(LogSession& session) const;
+
+    // Applies one command line option:
+    //   --from=YYYY-MM-DD  --to=YYYY-MM-DD  --weekdays=1-5 (1 = Monday)
+    //   --hours=07:00-19:00  --exclude-leave=terminated|hibernation|closed|manual
+    // Returns false if arg is not a filter option or has an invalid value.
+    bool ParseOption(const std::string& arg);
+};
+
+// Reports the archived and logged sessions that pass filter.
+//
+// The date range is pushed down into the readers: archive blocks before the
+// range are not decoded, the text log is entered by binary search at the
+// first line of the range, and both stop at the first record after it.
+bool ScanFilteredSessions(const std::string& logName, const std::string& archiveName,
+                          const SessionFilter& filter,
+                          const std::function<void(const LogSession&)>& onSession);
+
+// Offset of the first line of the log dated day or later, found by binary
+// search on line dates. Returns the file size if there is none.
+uint64_t FindDayOffset(const std::string& logName, int day);
+
+#endif // LOGQUERY_H
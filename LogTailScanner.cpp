@@ -0,0 +1,117 @@
+#include "LogTailScanner.h"
+#include "LogParser.h"
+#include "Logger.h"
+#include "Tags.h"
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+LogTailScanner::LogTailScanner(const std::string& fname, size_t size)
+    : filename(fname), blockSize(size ? size : 4096) {
+}
+
+bool LogTailScanner::ScanBackward(const std::function<bool(const std::string&)>& onLine) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.seekg(0, std::ios::end);
+    uint64_t position = (uint64_t)file.tellg();
+
+    std::vector<char> block(blockSize);
+    std::string carry;  // start of a line that continues in the next block
+
+    while (position > 0) {
+        size_t readSize = (size_t)std::min<uint64_t>(blockSize, position);
+        position -= readSize;
+        file.seekg((std::streamoff)position);
+        file.read(block.data(), (std::streamsize)readSize);
+        if ((size_t)file.gcount() != readSize) {
+            return true;
+        }
+
+        std::string text(block.data(), readSize);
+        text += carry;
+
+        // Every segment after a '\n' is a complete line. The first segment
+        // may still continue in the previous block.
+        size_t end = text.size();
+        while (end > 0) {
+            size_t newline = text.rfind('\n', end - 1);
+            if (newline == std::string::npos) {
+                break;
+            }
+            std::string line = text.substr(newline + 1, end - newline - 1);
+            end = newline;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty() && !onLine(line)) {
+                return true;
+            }
+        }
+        carry = text.substr(0, end);
+    }
+
+    if (!carry.empty()) {
+        if (carry.back() == '\r') {
+            carry.pop_back();
+        }
+        onLine(carry);
+    }
+    return true;
+}
+
+bool LogTailScanner::SummarizeDay(const std::string& fname,
+                                  const std::chrono::system_clock::time_point& day,
+                                  DaySummary& summary) {
+    summary.minutesWorked = 0;
+    summary.sessions = 0;
+    summary.open = false;
+    summary.openSince = std::chrono::system_clock::time_point{};
+    summary.tag = TagTable::NO_TAG;
+
+    // Records of the day start with its date key; the first older valid
+    // record ends the scan
+    std::string dayKey = LogParser::DateKey(day);
+    std::vector<std::string> dayLines;
+
+    LogTailScanner scanner(fname);
+    bool ok = scanner.ScanBackward([&](const std::string& line) {
+        if (line.compare(0, dayKey.size(), dayKey) == 0) {
+            dayLines.push_back(line);
+            return true;
+        }
+        // Skip lines that are not records at all
+        return LogParser::ParseTime(line) == std::chrono::system_clock::time_point{};
+    });
+    if (!ok) {
+        return false;
+    }
+
+    SessionBuilder builder;
+    LogSession session;
+    for (auto it = dayLines.rbegin(); it != dayLines.rend(); ++it) {
+        // A session of the day before may be switched to another tag after
+        // midnight; the session that SWITCH starts belongs to today
+        if (it == dayLines.rbegin() && LogParser::ParseEventKind(*it) == LogEventKind::Switch &&
+            builder.Resume(*it)) {
+            continue;
+        }
+        if (builder.AddLine(*it, session)) {
+            summary.minutesWorked += session.minutes;
+            summary.sessions++;
+            summary.tag = session.tag;
+        }
+    }
+    summary.open = builder.IsOpen();
+    if (summary.open) {
+        summary.openSince = builder.OpenSince();
+        summary.tag = builder.OpenTag();
+    }
+
+    LOG_DEBUG("Restored " + dayKey + " from " + std::to_string(dayLines.size()) +
+              " records: " + std::to_string(summary.minutesWorked) + " minutes");
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef LOGTAILSCANNER_H
+#define LOGTAILSCANNER_H
+
+#include <string>
+#include <chrono>
+#include <functional>
+
+// Work recorded on one calendar day
+struct DaySummary {
+    int minutesWorked;   // closed sessions that started on the day
+    int sessions;
+    bool open;           // a session of the day has no LEAVE yet
+    std::chrono::system_clock::time_point openSince;
+    int tag;             // tag of the latest session of the day
+};
+
+// Reads the time log backwards from its end in fixed-size blocks.
+//
+// Used at startup to find out what was already logged today without parsing
+// the whole history: the cost depends on the number of records of the day,
+// not on the size of the file.
+class LogTailScanner {
+public:
+    explicit LogTailScanner(const std::string& fname, size_t blockSize = 4096);
+
+    // Calls onLine for every line, newest first, until it returns false or
+    // the start of the file is reached. Returns false if the file could not
+    // be opened.
+    bool ScanBackward(const std::function<bool(const std::string&)>& onLine);
+
+    // Summarizes the records dated on the same local day as day. The scan
+    // stops at the first older record, so day must be the newest day in the
+    // log, which today always is.
+    static bool SummarizeDay(const std::string& fname,
+                             const std::chrono::system_clock::time_point& day,
+                             DaySummary& summary);
+
+private:
+    std::string filename;
+    size_t blockSize;
+};
+
+#endif // LOGTAILSCANNER_H
@@ -0,0 +1,240 @@
+#include "LogWriter.h"
+#include "LogParser.h"
+#include "Metrics.h"
+#include <fstream>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Offset of the sentinel byte that serves as the inter-process lock.
+// It lies far beyond any real log size, so locking it never overlaps data.
+static const unsigned long long LOCK_SENTINEL_OFFSET = 0x7FFFFFFF00000000ULL;
+
+#ifdef _WIN32
+
+bool LogWriter::WriteLocked(const std::string& fname, const std::string& data, bool append) {
+    HANDLE hFile = CreateFileA(fname.c_str(),
+        append ? FILE_APPEND_DATA : GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    OVERLAPPED lockRange = {};
+    lockRange.Offset = (DWORD)(LOCK_SENTINEL_OFFSET & 0xFFFFFFFF);
+    lockRange.OffsetHigh = (DWORD)(LOCK_SENTINEL_OFFSET >> 32);
+    if (!LockFileEx(hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &lockRange)) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    bool ok = true;
+    if (!append) {
+        LARGE_INTEGER zero = {};
+        ok = SetFilePointerEx(hFile, zero, NULL, FILE_BEGIN) && SetEndOfFile(hFile);
+    }
+
+    // FILE_APPEND_DATA makes the system position every write at end of file,
+    // so one WriteFile per record can never interleave with another writer.
+    DWORD written = 0;
+    if (ok) {
+        ok = WriteFile(hFile, data.data(), (DWORD)data.size(), &written, NULL) &&
+             written == (DWORD)data.size();
+    }
+
+    UnlockFileEx(hFile, 0, 1, 0, &lockRange);
+    CloseHandle(hFile);
+    return ok;
+}
+
+bool LogWriter::DropPrefix(const std::string& fname, const std::string& prefix) {
+    HANDLE hFile = CreateFileA(fname.c_str(), GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    OVERLAPPED lockRange = {};
+    lockRange.Offset = (DWORD)(LOCK_SENTINEL_OFFSET & 0xFFFFFFFF);
+    lockRange.OffsetHigh = (DWORD)(LOCK_SENTINEL_OFFSET >> 32);
+    if (!LockFileEx(hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &lockRange)) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    // Read everything under the lock, so no concurrent append can be lost
+    std::string content;
+    char buffer[65536];
+    DWORD bytesRead = 0;
+    bool ok = true;
+    while ((ok = ReadFile(hFile, buffer, sizeof(buffer), &bytesRead, NULL) != FALSE) && bytesRead > 0) {
+        content.append(buffer, bytesRead);
+    }
+
+    ok = ok && content.compare(0, prefix.size(), prefix) == 0;
+    if (ok) {
+        LARGE_INTEGER zero = {};
+        DWORD written = 0;
+        DWORD remaining = (DWORD)(content.size() - prefix.size());
+        ok = SetFilePointerEx(hFile, zero, NULL, FILE_BEGIN) &&
+             WriteFile(hFile, content.data() + prefix.size(), remaining, &written, NULL) &&
+             written == remaining &&
+             SetEndOfFile(hFile);
+    }
+
+    UnlockFileEx(hFile, 0, 1, 0, &lockRange);
+    CloseHandle(hFile);
+    return ok;
+}
+
+bool LogWriter::ReplaceFile(const std::string& srcFname, const std::string& fname) {
+    return MoveFileExA(srcFname.c_str(), fname.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+#else
+
+bool LogWriter::WriteLocked(const std::string& fname, const std::string& data, bool append) {
+    int fd = open(fname.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : 0), 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct flock lockRange = {};
+    lockRange.l_type = F_WRLCK;
+    lockRange.l_whence = SEEK_SET;
+    lockRange.l_start = (off_t)LOCK_SENTINEL_OFFSET;
+    lockRange.l_len = 1;
+    while (fcntl(fd, F_SETLKW, &lockRange) == -1) {
+        if (errno != EINTR) {
+            close(fd);
+            return false;
+        }
+    }
+
+    bool ok = true;
+    if (!append) {
+        ok = ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0;
+    }
+
+    // O_APPEND positions every write at end of file. Records are small, so a
+    // single write() normally covers them; the loop only guards against short
+    // writes, which are still serialized by the lock.
+    size_t offset = 0;
+    while (ok && offset < data.size()) {
+        ssize_t n = write(fd, data.data() + offset, data.size() - offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+        } else {
+            offset += (size_t)n;
+        }
+    }
+
+    lockRange.l_type = F_UNLCK;
+    fcntl(fd, F_SETLK, &lockRange);
+    close(fd);
+    return ok;
+}
+
+bool LogWriter::DropPrefix(const std::string& fname, const std::string& prefix) {
+    int fd = open(fname.c_str(), O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct flock lockRange = {};
+    lockRange.l_type = F_WRLCK;
+    lockRange.l_whence = SEEK_SET;
+    lockRange.l_start = (off_t)LOCK_SENTINEL_OFFSET;
+    lockRange.l_len = 1;
+    while (fcntl(fd, F_SETLKW, &lockRange) == -1) {
+        if (errno != EINTR) {
+            close(fd);
+            return false;
+        }
+    }
+
+    // Read everything under the lock, so no concurrent append can be lost
+    std::string content;
+    char buffer[65536];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        content.append(buffer, (size_t)n);
+    }
+
+    bool ok = n == 0 && content.compare(0, prefix.size(), prefix) == 0;
+    size_t offset = prefix.size();
+    off_t position = 0;
+    while (ok && offset < content.size()) {
+        ssize_t written = pwrite(fd, content.data() + offset, content.size() - offset, position);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+        } else {
+            offset += (size_t)written;
+            position += written;
+        }
+    }
+    ok = ok && ftruncate(fd, (off_t)(content.size() - prefix.size())) == 0;
+
+    lockRange.l_type = F_UNLCK;
+    fcntl(fd, F_SETLK, &lockRange);
+    close(fd);
+    return ok;
+}
+
+bool LogWriter::ReplaceFile(const std::string& srcFname, const std::string& fname) {
+    return std::rename(srcFname.c_str(), fname.c_str()) == 0;
+}
+
+#endif
+
+bool LogWriter::AppendRecord(const std::string& fname, const std::string& record) {
+    return WriteLocked(fname, record + LOG_LINE_END, true);
+}
+
+bool LogWriter::ReplaceRecord(const std::string& fname, const std::string& record) {
+    return WriteLocked(fname, record + LOG_LINE_END, false);
+}
+
+bool LogWriter::WriteRecord(const std::string& fname, const LogRecord& record, bool append) {
+    METRICS_SCOPED_TIMER(TIMER_WRITE);
+    METRICS_COUNT(COUNTER_RECORDS_WRITTEN, 1);
+    std::string line = LogParser::FormatRecord(record);
+    return append ? AppendRecord(fname, line) : ReplaceRecord(fname, line);
+}
+
+bool LogWriter::ReplaceContents(const std::string& fname, const std::string& data) {
+    return WriteLocked(fname, data, false);
+}
+
+bool LogWriter::AppendFile(const std::string& fname, const std::string& srcFname) {
+    std::ifstream src(srcFname, std::ios::binary | std::ios::ate);
+    if (!src.is_open()) {
+        return false;
+    }
+    // One read into a buffer of the file's size
+    std::string data((size_t)src.tellg(), '\0');
+    src.seekg(0);
+    if (!src.read(&data[0], (std::streamsize)data.size())) {
+        return false;
+    }
+    src.close();
+
+    if (data.empty()) {
+        return true;
+    }
+    return WriteLocked(fname, data, true);
+}
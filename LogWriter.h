@@ -0,0 +1,55 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <string>
+
+struct LogRecord;
+
+// Line terminator used for log records. Matches what std::endl produced in
+// text mode before records were written through LogWriter.
+#ifdef _WIN32
+#define LOG_LINE_END "\r\n"
+#else
+#define LOG_LINE_END "\n"
+#endif
+
+// Concurrency-safe writer for the time log.
+//
+// Several TimeRecording instances (or a roaming-profile sync) may touch the
+// same Timelog.txt. Every record is therefore written with a single write
+// call on a handle opened in append mode, while holding an exclusive lock on
+// a sentinel byte range far beyond the end of the file. The sentinel keeps
+// the lock advisory on Windows as well, so readers of the log (the summary
+// parser, an editor opened via "Open Log") are never blocked.
+class LogWriter {
+public:
+    // Appends one record (without line terminator) to fname.
+    static bool AppendRecord(const std::string& fname, const std::string& record);
+
+    // Replaces the whole content of fname with one record.
+    static bool ReplaceRecord(const std::string& fname, const std::string& record);
+
+    // Appends record, or replaces fname with it, in the text of
+    // LogParser::FormatRecord. Every event the tracker logs is written here,
+    // timed as TIMER_WRITE.
+    static bool WriteRecord(const std::string& fname, const LogRecord& record, bool append = true);
+
+    // Replaces the whole content of fname with raw data (no line terminator added).
+    static bool ReplaceContents(const std::string& fname, const std::string& data);
+
+    // Appends the complete content of srcFname to fname in one locked write.
+    static bool AppendFile(const std::string& fname, const std::string& srcFname);
+
+    // Removes prefix from the start of fname, keeping everything appended
+    // after it. Fails without changes if fname no longer starts with prefix.
+    static bool DropPrefix(const std::string& fname, const std::string& prefix);
+
+    // Moves srcFname over fname in one step, so fname is the old or the new
+    // file even if the process dies halfway.
+    static bool ReplaceFile(const std::string& srcFname, const std::string& fname);
+
+private:
+    static bool WriteLocked(const std::string& fname, const std::string& data, bool append);
+};
+
+#endif // LOGWRITER_H
@@ -0,0 +1,111 @@
+#include "Logger.h"
+#include <fstream>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Buffered bytes that trigger a write to the log file
+static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+#ifdef _DEBUG
+std::atomic<int> Logger::currentLevel((int)LogLevel::Debug);
+#else
+std::atomic<int> Logger::currentLevel((int)LogLevel::Warning);
+#endif
+
+namespace {
+
+struct LogSink {
+    std::mutex mutex;
+    std::string fname = "debug_log.txt";
+    std::string buffer;
+
+    void FlushLocked() {
+        if (buffer.empty()) {
+            return;
+        }
+        std::ofstream file(fname, std::ios::app | std::ios::binary);
+        file.write(buffer.data(), (std::streamsize)buffer.size());
+        buffer.clear();
+    }
+
+    ~LogSink() {
+        std::lock_guard<std::mutex> lock(mutex);
+        FlushLocked();
+    }
+};
+
+LogSink& GetSink() {
+    static LogSink sink;
+    return sink;
+}
+
+const char* LevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Error: return "ERROR";
+        case LogLevel::Warning: return "WARN ";
+        case LogLevel::Info: return "INFO ";
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Trace: return "TRACE";
+        default: return "     ";
+    }
+}
+
+} // namespace
+
+void Logger::SetLevel(LogLevel level) {
+    currentLevel.store((int)level, std::memory_order_relaxed);
+}
+
+LogLevel Logger::GetLevel() {
+    return (LogLevel)currentLevel.load(std::memory_order_relaxed);
+}
+
+void Logger::SetFile(const std::string& fname) {
+    LogSink& sink = GetSink();
+    std::lock_guard<std::mutex> lock(sink.mutex);
+    sink.FlushLocked();
+    sink.fname = fname;
+}
+
+void Logger::Write(LogLevel level, const std::string& message) {
+    std::string line = std::string(LevelName(level)) + " " + message + "\n";
+
+    #ifdef _WIN32
+    // Visible in the Visual Studio Output window
+    OutputDebugStringA(line.c_str());
+    #endif
+
+    LogSink& sink = GetSink();
+    std::lock_guard<std::mutex> lock(sink.mutex);
+    sink.buffer += line;
+    if (sink.buffer.size() >= FLUSH_THRESHOLD || level <= LogLevel::Error) {
+        sink.FlushLocked();
+    }
+}
+
+void Logger::Flush() {
+    LogSink& sink = GetSink();
+    std::lock_guard<std::mutex> lock(sink.mutex);
+    sink.FlushLocked();
+}
+
+bool Logger::ParseLevel(const std::string& text, LogLevel& level) {
+    static const struct { const char* name; LogLevel level; } names[] = {
+        { "off", LogLevel::Off },
+        { "error", LogLevel::Error },
+        { "warning", LogLevel::Warning },
+        { "info", LogLevel::Info },
+        { "debug", LogLevel::Debug },
+        { "trace", LogLevel::Trace },
+    };
+    for (const auto& entry : names) {
+        if (text == entry.name) {
+            level = entry.level;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,52 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <atomic>
+
+// Severity levels, most severe first
+enum class LogLevel {
+    Off,
+    Error,
+    Warning,
+    Info,
+    Debug,
+    Trace
+};
+
+// Buffered, level-filtered diagnostic logger.
+//
+// Messages below the current level are rejected before their text is built
+// (see the LOG_* macros). Accepted messages collect in memory and are written
+// to the debug log file in one go when the buffer fills up, on Flush() and at
+// process exit. On Windows, accepted messages also go to OutputDebugString.
+class Logger {
+public:
+    static void SetLevel(LogLevel level);
+    static LogLevel GetLevel();
+    static bool IsEnabled(LogLevel level) {
+        return level != LogLevel::Off &&
+               (int)level <= currentLevel.load(std::memory_order_relaxed);
+    }
+
+    static void SetFile(const std::string& fname);
+    static void Write(LogLevel level, const std::string& message);
+    static void Flush();
+
+    // Parses "off", "error", "warning", "info", "debug" or "trace"
+    static bool ParseLevel(const std::string& text, LogLevel& level);
+
+private:
+    static std::atomic<int> currentLevel;
+};
+
+#define LOG_AT(level, message) \
+    do { if (Logger::IsEnabled(level)) Logger::Write(level, message); } while (0)
+
+#define LOG_ERROR(message) LOG_AT(LogLevel::Error, message)
+#define LOG_WARNING(message) LOG_AT(LogLevel::Warning, message)
+#define LOG_INFO(message) LOG_AT(LogLevel::Info, message)
+#define LOG_DEBUG(message) LOG_AT(LogLevel::Debug, message)
+#define LOG_TRACE(message) LOG_AT(LogLevel::Trace, message)
+
+#endif // LOGGER_H
@@ -0,0 +1,277 @@
+#include "Metrics.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static int HighestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+LatencyHistogram::LatencyHistogram() : count(0), sum(0), max(0) {
+    std::fill(buckets, buckets + BUCKET_COUNT, 0);
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < (uint64_t)SUB_BUCKETS) {
+        return (int)value;
+    }
+    int msb = HighestBit(value);
+    int shift = msb - SUB_BUCKET_BITS;
+    int sub = (int)(value >> shift) - SUB_BUCKETS;
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index) {
+    int group = index / SUB_BUCKETS;
+    int sub = index % SUB_BUCKETS;
+    if (group == 0) {
+        return (uint64_t)sub;
+    }
+    int shift = group - 1;
+    uint64_t lower = (uint64_t)(SUB_BUCKETS + sub) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    buckets[BucketIndex(value)]++;
+    count++;
+    sum += value;
+    if (value > max) max = value;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max) max = other.max;
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)count + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(BucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+namespace {
+
+// Written only by its owning thread; other threads read it while dumping.
+// Relaxed load+store keeps the increment free of locked instructions.
+struct ThreadBlock {
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    std::atomic<uint64_t> buckets[TIMER_COUNT][LatencyHistogram::BUCKET_COUNT];
+    std::atomic<uint64_t> sums[TIMER_COUNT];
+    std::atomic<uint64_t> maxima[TIMER_COUNT];
+
+    ThreadBlock() {
+        for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+        for (auto& timer : buckets) {
+            for (auto& b : timer) b.store(0, std::memory_order_relaxed);
+        }
+        for (auto& s : sums) s.store(0, std::memory_order_relaxed);
+        for (auto& m : maxima) m.store(0, std::memory_order_relaxed);
+    }
+
+    void SnapshotInto(uint64_t* outCounters, LatencyHistogram* outTimers) const {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            outCounters[c] += counters[c].load(std::memory_order_relaxed);
+        }
+        for (int t = 0; t < TIMER_COUNT; t++) {
+            LatencyHistogram& h = outTimers[t];
+            for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+                uint64_t n = buckets[t][i].load(std::memory_order_relaxed);
+                h.buckets[i] += n;
+                h.count += n;
+            }
+            h.sum += sums[t].load(std::memory_order_relaxed);
+            h.max = std::max(h.max, maxima[t].load(std::memory_order_relaxed));
+        }
+    }
+};
+
+inline void Bump(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadBlock*> live;
+    uint64_t retiredCounters[COUNTER_COUNT] = {};
+    LatencyHistogram retiredTimers[TIMER_COUNT];
+};
+
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+// Registers the calling thread's block on first use and folds it into the
+// retired totals when the thread exits
+struct ThreadSlot {
+    ThreadBlock block;
+
+    ThreadSlot() {
+        Registry& r = GetRegistry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(&block);
+    }
+
+    ~ThreadSlot() {
+        Registry& r = GetRegistry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        block.SnapshotInto(r.retiredCounters, r.retiredTimers);
+        r.live.erase(std::remove(r.live.begin(), r.live.end(), &block), r.live.end());
+    }
+};
+
+ThreadBlock& LocalBlock() {
+    thread_local ThreadSlot slot;
+    return slot.block;
+}
+
+void Snapshot(uint64_t* counters, LatencyHistogram* timers) {
+    Registry& r = GetRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        counters[c] = r.retiredCounters[c];
+    }
+    for (int t = 0; t < TIMER_COUNT; t++) {
+        timers[t] = r.retiredTimers[t];
+    }
+    for (const ThreadBlock* block : r.live) {
+        block->SnapshotInto(counters, timers);
+    }
+}
+
+} // namespace
+
+bool Metrics::IsEnabled() {
+#ifdef TIMERECORDING_METRICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Metrics::Count(MetricCounter counter, uint64_t delta) {
+    Bump(LocalBlock().counters[counter], delta);
+}
+
+void Metrics::RecordLatency(MetricTimer timer, uint64_t nanoseconds) {
+    ThreadBlock& block = LocalBlock();
+    Bump(block.buckets[timer][LatencyHistogram::BucketIndex(nanoseconds)], 1);
+    Bump(block.sums[timer], nanoseconds);
+    if (nanoseconds > block.maxima[timer].load(std::memory_order_relaxed)) {
+        block.maxima[timer].store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+const char* Metrics::TimerName(MetricTimer timer) {
+    switch (timer) {
+        case TIMER_PARSE: return "parse";
+        case TIMER_AGGREGATE: return "aggregate";
+        case TIMER_RENDER: return "render";
+        case TIMER_WRITE: return "write";
+        case TIMER_STARTUP: return "startup";
+        default: return "unknown";
+    }
+}
+
+const char* Metrics::CounterName(MetricCounter counter) {
+    switch (counter) {
+        case COUNTER_LINES_READ: return "lines_read";
+        case COUNTER_PARSE_ERRORS: return "parse_errors";
+        case COUNTER_SESSIONS: return "sessions";
+        case COUNTER_RECORDS_WRITTEN: return "records_written";
+        default: return "unknown";
+    }
+}
+
+std::string Metrics::DumpText() {
+    if (!IsEnabled()) {
+        return "Metrics disabled (build with /DTIMERECORDING_METRICS)\n";
+    }
+
+    uint64_t counters[COUNTER_COUNT];
+    LatencyHistogram timers[TIMER_COUNT];
+    Snapshot(counters, timers);
+
+    std::stringstream ss;
+    ss << "Counters:\n";
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        ss << "  " << std::left << std::setw(16) << CounterName((MetricCounter)c)
+           << counters[c] << "\n";
+    }
+
+    ss << "Timers (microseconds):\n";
+    ss << "  " << std::left << std::setw(12) << "name" << std::right
+       << std::setw(10) << "count" << std::setw(12) << "mean"
+       << std::setw(12) << "p50" << std::setw(12) << "p90"
+       << std::setw(12) << "p99" << std::setw(12) << "max" << "\n";
+    ss << std::fixed << std::setprecision(1);
+    for (int t = 0; t < TIMER_COUNT; t++) {
+        const LatencyHistogram& h = timers[t];
+        double mean = h.count ? (double)h.sum / (double)h.count : 0.0;
+        ss << "  " << std::left << std::setw(12) << TimerName((MetricTimer)t) << std::right
+           << std::setw(10) << h.count
+           << std::setw(12) << mean / 1000.0
+           << std::setw(12) << h.Percentile(50) / 1000.0
+           << std::setw(12) << h.Percentile(90) / 1000.0
+           << std::setw(12) << h.Percentile(99) / 1000.0
+           << std::setw(12) << h.max / 1000.0 << "\n";
+    }
+    return ss.str();
+}
+
+std::string Metrics::DumpJson() {
+    if (!IsEnabled()) {
+        return "{\"enabled\":false}";
+    }
+
+    uint64_t counters[COUNTER_COUNT];
+    LatencyHistogram timers[TIMER_COUNT];
+    Snapshot(counters, timers);
+
+    std::stringstream ss;
+    ss << "{\"enabled\":true,\"counters\":{";
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        ss << (c ? "," : "") << "\"" << CounterName((MetricCounter)c) << "\":" << counters[c];
+    }
+    ss << "},\"timers\":{";
+    for (int t = 0; t < TIMER_COUNT; t++) {
+        const LatencyHistogram& h = timers[t];
+        ss << (t ? "," : "") << "\"" << TimerName((MetricTimer)t) << "\":{"
+           << "\"count\":" << h.count
+           << ",\"sum_ns\":" << h.sum
+           << ",\"p50_ns\":" << h.Percentile(50)
+           << ",\"p90_ns\":" << h.Percentile(90)
+           << ",\"p99_ns\":" << h.Percentile(99)
+           << ",\"max_ns\":" << h.max << "}";
+    }
+    ss << "}}";
+    return ss.str();
+}
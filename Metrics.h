@@ -0,0 +1,104 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+#include <string>
+#include <chrono>
+
+// Lightweight instrumentation for the hot paths of the tracker.
+//
+// Counters and latency histograms live in a per-thread block. Only the
+// owning thread writes a block, so recording a sample is a relaxed atomic
+// load and store, not a locked read-modify-write. The values are atomic
+// because the dump functions read every thread's block while its owner may
+// be writing it; relaxed order suffices, as each value is summed on its own.
+//
+// Instrumentation is compiled in only when TIMERECORDING_METRICS is defined
+// (cl /DTIMERECORDING_METRICS ...). Otherwise the METRICS_* macros expand to
+// nothing and the dump functions report that metrics are disabled.
+
+// Latency histograms, recorded by scoped timers
+enum MetricTimer {
+    TIMER_PARSE,      // one log line to time_point (incl. mktime)
+    TIMER_AGGREGATE,  // one full pass over the log into summary rows or tag totals
+    TIMER_RENDER,     // summary formatting and dialog creation
+    TIMER_WRITE,      // one record appended to disk
+    TIMER_STARTUP,    // log I/O of a launch, crash recovery to ARRIVE
+    TIMER_COUNT
+};
+
+// Monotonic event counters
+enum MetricCounter {
+    COUNTER_LINES_READ,
+    COUNTER_PARSE_ERRORS,
+    COUNTER_SESSIONS,
+    COUNTER_RECORDS_WRITTEN,
+    COUNTER_COUNT
+};
+
+// HDR-style log-linear histogram of nanosecond values. Each power of two is
+// split into 8 linear sub-buckets, which bounds the relative error of any
+// reported percentile to 12.5% over the full 64-bit range.
+struct LatencyHistogram {
+    static const int SUB_BUCKET_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    uint64_t buckets[BUCKET_COUNT];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    LatencyHistogram();
+    void Record(uint64_t value);
+    void Merge(const LatencyHistogram& other);
+    uint64_t Percentile(double p) const;
+
+    static int BucketIndex(uint64_t value);
+    static uint64_t BucketUpperBound(int index);
+};
+
+class Metrics {
+public:
+    static bool IsEnabled();
+
+    static void Count(MetricCounter counter, uint64_t delta = 1);
+    static void RecordLatency(MetricTimer timer, uint64_t nanoseconds);
+
+    // Summed over all threads, including ones that already exited
+    static std::string DumpText();
+    static std::string DumpJson();
+
+    static const char* TimerName(MetricTimer timer);
+    static const char* CounterName(MetricCounter counter);
+};
+
+// Records the lifetime of the enclosing scope into a latency histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(MetricTimer t)
+        : timer(t), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        Metrics::RecordLatency(timer, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    MetricTimer timer;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define METRICS_CONCAT_INNER(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_INNER(a, b)
+
+#ifdef TIMERECORDING_METRICS
+#define METRICS_SCOPED_TIMER(timer) ScopedTimer METRICS_CONCAT(scopedTimer_, __LINE__)(timer)
+#define METRICS_COUNT(counter, delta) Metrics::Count(counter, delta)
+#else
+#define METRICS_SCOPED_TIMER(timer) ((void)0)
+#define METRICS_COUNT(counter, delta) ((void)0)
+#endif
+
+#endif // METRICS_H
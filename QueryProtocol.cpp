@@ -0,0 +1,93 @@
+#include "QueryProtocol.h"
+#include "IsoCalendar.h"
+#include "Metrics.h"
+#include <sstream>
+#include <cstdio>
+#include <climits>
+#include <ctime>
+#include <algorithm>
+
+static std::string IsoDate(int day) {
+    CivilDate date = IsoCalendar::CivilFromDays(day);
+    char buffer[32];  // any int year, month and day
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", date.year, date.month, date.day);
+    return buffer;
+}
+
+// Closed minutes from the rollup plus the running session of today
+static int64_t RangeMinutes(const DayRollup& rollup, const TrackerState& state, int today, int from, int to) {
+    if (from <= today && today <= to) {
+        return rollup.Sum(from, today - 1) + state.minutesToday + rollup.Sum(today + 1, to);
+    }
+    return rollup.Sum(from, to);
+}
+
+std::string AnswerQuery(const std::string& request, const TrackerState& state, const DayRollup& rollup) {
+    std::istringstream in(request);
+    std::string command;
+    in >> command;
+
+    int today = IsoCalendar::LocalDayNumber(state.now);
+    std::ostringstream out;
+
+    if (command == "STATE") {
+        std::time_t tt = std::chrono::system_clock::to_time_t(state.arriveTime);
+        std::tm tm = *std::localtime(&tt);
+        char arrive[16];
+        std::strftime(arrive, sizeof(arrive), "%H:%M:%S", &tm);
+
+        out << "present=" << (state.present ? 1 : 0) << "\n";
+        if (state.present) {
+            out << "arrive=" << arrive << "\n";
+        }
+        out << "today=" << state.minutesToday << "\n";
+        out << "tag=" << state.tag << "\n";
+    } else if (command == "TODAY") {
+        out << "minutes=" << state.minutesToday << "\n";
+    } else if (command == "WEEK") {
+        int monday = today - (IsoCalendar::Weekday(today) - 1);
+        out << "week=" << IsoCalendar::WeekKey(today) << "\n";
+        out << "minutes=" << RangeMinutes(rollup, state, today, monday, today) << "\n";
+    } else if (command == "RANGE" || command == "DAYS") {
+        std::string fromText, toText;
+        int from, to;
+        if (!(in >> fromText >> toText) || !IsoCalendar::ParseIsoDate(fromText, from) ||
+            !IsoCalendar::ParseIsoDate(toText, to) || from > to) {
+            return "error=expected " + command + " YYYY-MM-DD YYYY-MM-DD\n";
+        }
+        if (command == "RANGE") {
+            out << "minutes=" << RangeMinutes(rollup, state, today, from, to) << "\n";
+        } else {
+            // Only days the log covers; days without work are listed as 0
+            int first = std::max(from, rollup.IsEmpty() ? today : std::min(rollup.FirstDay(), today));
+            int last = std::min(to, std::max(rollup.IsEmpty() ? today : rollup.LastDay(), today));
+            for (int day = first; day <= last; day++) {
+                out << IsoDate(day) << "=" << RangeMinutes(rollup, state, today, day, day) << "\n";
+            }
+        }
+    } else if (command == "TOP") {
+        int k = 0;
+        std::string fromText, toText;
+        int from = INT_MIN / 2;
+        int to = INT_MAX / 2;
+        if (!(in >> k) || k <= 0) {
+            return "error=expected TOP k [YYYY-MM-DD YYYY-MM-DD]\n";
+        }
+        if (in >> fromText >> toText &&
+            (!IsoCalendar::ParseIsoDate(fromText, from) || !IsoCalendar::ParseIsoDate(toText, to))) {
+            return "error=expected TOP k [YYYY-MM-DD YYYY-MM-DD]\n";
+        }
+        if (!rollup.IsEmpty()) {
+            from = std::max(from, rollup.FirstDay());
+            to = std::min(to, rollup.LastDay());
+        }
+        for (const DayTotal& total : rollup.TopDays(k, from, to)) {
+            out << IsoDate(total.day) << "=" << total.minutes << "\n";
+        }
+    } else if (command == "METRICS") {
+        out << "metrics=" << Metrics::DumpJson() << "\n";
+    } else {
+        return "error=unknown request\n";
+    }
+    return out.str();
+}
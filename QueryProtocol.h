@@ -0,0 +1,28 @@
+#ifndef QUERYPROTOCOL_H
+#define QUERYPROTOCOL_H
+
+#include <string>
+#include <chrono>
+#include "DayRollup.h"
+
+// Live state of the tracker as reported to query clients
+struct TrackerState {
+    bool present;
+    std::chrono::system_clock::time_point arriveTime;
+    int minutesToday;    // as shown in the main window
+    std::string tag;
+    std::chrono::system_clock::time_point now;
+};
+
+// Answers one request of the query endpoint from the live state and the
+// day rollup, without reading the log. Requests (case sensitive):
+//   STATE                          present, arrival, today, tag
+//   TODAY | WEEK                   minutes of today / the current ISO week
+//   RANGE YYYY-MM-DD YYYY-MM-DD    minutes of an inclusive day range
+//   DAYS YYYY-MM-DD YYYY-MM-DD     minutes per day of a range
+//   TOP k [YYYY-MM-DD YYYY-MM-DD]  the k longest days
+//   METRICS                        Metrics::DumpJson() on one line
+// Responses are "key=value" lines; failures answer "error=<reason>".
+std::string AnswerQuery(const std::string& request, const TrackerState& state, const DayRollup& rollup);
+
+#endif // QUERYPROTOCOL_H
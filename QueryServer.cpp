@@ -0,0 +1,384 @@
+#include "QueryServer.h"
+#include "Logger.h"
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <sddl.h>
+#pragma comment(lib, "advapi32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#endif
+
+// Request line without its terminator
+static std::string TrimRequest(const std::string& data) {
+    size_t end = data.find_first_of("\r\n");
+    return end == std::string::npos ? data : data.substr(0, end);
+}
+
+#ifdef _WIN32
+
+// String form of the SID of the user running this process, empty on failure
+static std::string CurrentUserSid() {
+    HANDLE token = NULL;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) {
+        return std::string();
+    }
+    std::string sid;
+    DWORD size = 0;
+    GetTokenInformation(token, TokenUser, NULL, 0, &size);
+    std::vector<char> buffer(size);
+    char* text = NULL;
+    if (size > 0 && GetTokenInformation(token, TokenUser, buffer.data(), size, &size) &&
+        ConvertSidToStringSidA(((TOKEN_USER*)buffer.data())->User.Sid, &text)) {
+        sid = text;
+        LocalFree(text);
+    }
+    CloseHandle(token);
+    return sid;
+}
+
+std::string QueryServer::DefaultEndpoint() {
+    // Per user, so sessions of different users never meet on one name
+    std::string sid = CurrentUserSid();
+    return sid.empty() ? std::string() : "\\\\.\\pipe\\TimeRecording-" + sid;
+}
+
+QueryServer::QueryServer() : running(false), stopEvent(NULL), security(NULL) {
+}
+
+bool QueryServer::Start(const std::string& name, Handler onRequest) {
+    if (running) {
+        return false;
+    }
+    // Protected DACL granting access to the current user only
+    std::string sid = CurrentUserSid();
+    PSECURITY_DESCRIPTOR descriptor = NULL;
+    if (sid.empty() ||
+        !ConvertStringSecurityDescriptorToSecurityDescriptorA(("D:P(A;;GA;;;" + sid + ")").c_str(),
+                                                              SDDL_REVISION_1, &descriptor, NULL)) {
+        LOG_ERROR("Could not create the security descriptor of " + name);
+        return false;
+    }
+    endpoint = name;
+    handler = onRequest;
+    security = descriptor;
+    stopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (stopEvent == NULL) {
+        LocalFree(security);
+        security = NULL;
+        return false;
+    }
+    running = true;
+    worker = std::thread(&QueryServer::Serve, this);
+    LOG_INFO("Query endpoint: " + endpoint);
+    return true;
+}
+
+void QueryServer::Stop() {
+    if (!running) {
+        return;
+    }
+    SetEvent(stopEvent);
+    worker.join();
+    CloseHandle(stopEvent);
+    stopEvent = NULL;
+    LocalFree(security);
+    security = NULL;
+    running = false;
+}
+
+// Waits for an overlapped operation or the stop event. Returns false on stop
+// or failure.
+static bool WaitIo(HANDLE pipe, OVERLAPPED& overlapped, BOOL started, HANDLE stopEvent, DWORD& bytes) {
+    if (!started && GetLastError() != ERROR_IO_PENDING && GetLastError() != ERROR_MORE_DATA) {
+        return GetLastError() == ERROR_PIPE_CONNECTED;
+    }
+    HANDLE events[2] = { overlapped.hEvent, stopEvent };
+    if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0) {
+        CancelIo(pipe);
+        GetOverlappedResult(pipe, &overlapped, &bytes, TRUE);
+        return false;
+    }
+    return GetOverlappedResult(pipe, &overlapped, &bytes, FALSE) || GetLastError() == ERROR_MORE_DATA;
+}
+
+// The first instance fails if another process owns the name already. The
+// next one is created while the current one still exists, so the name is
+// never free for another process to take over.
+static HANDLE CreatePipeInstance(const std::string& endpoint, void* security, bool first) {
+    SECURITY_ATTRIBUTES attributes = {};
+    attributes.nLength = sizeof(attributes);
+    attributes.lpSecurityDescriptor = security;
+    attributes.bInheritHandle = FALSE;
+    // PIPE_REJECT_REMOTE_CLIENTS keeps the endpoint local to this machine
+    HANDLE pipe = CreateNamedPipeA(endpoint.c_str(),
+        PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+        PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+        2, (DWORD)QueryServer::MAX_MESSAGE, (DWORD)QueryServer::MAX_MESSAGE, 0, &attributes);
+    if (pipe == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("Could not create query pipe " + endpoint + (first ? " (in use by another process?)" : ""));
+    }
+    return pipe;
+}
+
+void QueryServer::Serve() {
+    HANDLE ioEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    std::vector<char> buffer(MAX_MESSAGE);
+    HANDLE pipe = CreatePipeInstance(endpoint, security, true);
+
+    while (pipe != INVALID_HANDLE_VALUE) {
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = ioEvent;
+        DWORD bytes = 0;
+        ResetEvent(ioEvent);
+        if (!WaitIo(pipe, overlapped, ConnectNamedPipe(pipe, &overlapped), stopEvent, bytes)) {
+            DisconnectNamedPipe(pipe);
+            if (WaitForSingleObject(stopEvent, 0) == WAIT_OBJECT_0) {
+                break;
+            }
+            continue;
+        }
+
+        ResetEvent(ioEvent);
+        bytes = 0;
+        if (WaitIo(pipe, overlapped, ReadFile(pipe, buffer.data(), (DWORD)buffer.size(), NULL, &overlapped),
+                   stopEvent, bytes)) {
+            std::string response = handler(TrimRequest(std::string(buffer.data(), bytes)));
+            if (response.size() > MAX_MESSAGE) {
+                response.resize(MAX_MESSAGE);
+            }
+            ResetEvent(ioEvent);
+            WaitIo(pipe, overlapped, WriteFile(pipe, response.data(), (DWORD)response.size(), NULL, &overlapped),
+                   stopEvent, bytes);
+            FlushFileBuffers(pipe);
+        }
+
+        HANDLE next = CreatePipeInstance(endpoint, security, false);
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+        pipe = next;
+
+        if (WaitForSingleObject(stopEvent, 0) == WAIT_OBJECT_0) {
+            break;
+        }
+    }
+    if (pipe != INVALID_HANDLE_VALUE) {
+        CloseHandle(pipe);
+    }
+    CloseHandle(ioEvent);
+}
+
+bool SendQuery(const std::string& endpoint, const std::string& request, std::string& response) {
+    std::vector<char> buffer(QueryServer::MAX_MESSAGE);
+    DWORD bytes = 0;
+    // Connects, writes, reads and closes in one call; waits up to 1 s for a
+    // busy server
+    if (!CallNamedPipeA(endpoint.c_str(), (LPVOID)request.data(), (DWORD)request.size(),
+                        buffer.data(), (DWORD)buffer.size(), &bytes, 1000)) {
+        return false;
+    }
+    response.assign(buffer.data(), bytes);
+    return true;
+}
+
+#else
+
+// A client that hung up must not raise SIGPIPE in the tracker
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+std::string QueryServer::DefaultEndpoint() {
+    // The runtime directory belongs to the user and is not readable by others
+    const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir == NULL || runtimeDir[0] != '/') {
+        return std::string();
+    }
+    return std::string(runtimeDir) + "/timerecording.sock";
+}
+
+QueryServer::QueryServer() : running(false), listenFd(-1), socketId(0) {
+    stopPipe[0] = stopPipe[1] = -1;
+}
+
+// A socket file left behind by a server of this user that is gone may be
+// replaced; anything else at path is left alone.
+static bool IsStaleSocket(const std::string& path, const sockaddr_un& address) {
+    struct stat info;
+    if (lstat(path.c_str(), &info) != 0 || !S_ISSOCK(info.st_mode) || info.st_uid != getuid()) {
+        return false;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        return false;
+    }
+    bool listening = connect(probe, (const sockaddr*)&address, sizeof(address)) == 0;
+    close(probe);
+    return !listening;
+}
+
+bool QueryServer::Start(const std::string& path, Handler onRequest) {
+    if (running) {
+        return false;
+    }
+    sockaddr_un address = {};
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        LOG_ERROR("Invalid query endpoint: " + path);
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0) {
+        if (!IsStaleSocket(path, address)) {
+            LOG_ERROR("Query endpoint " + path + " exists and is not a stale socket of this user");
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        return false;
+    }
+    if (bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+        lstat(path.c_str(), &info) != 0 || listen(listenFd, 8) != 0 || pipe(stopPipe) != 0) {
+        LOG_ERROR("Could not listen on " + path);
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    socketId = (unsigned long long)info.st_ino;
+
+    endpoint = path;
+    handler = onRequest;
+    running = true;
+    worker = std::thread(&QueryServer::Serve, this);
+    LOG_INFO("Query endpoint: " + endpoint);
+    return true;
+}
+
+void QueryServer::Stop() {
+    if (!running) {
+        return;
+    }
+    char wake = 0;
+    if (write(stopPipe[1], &wake, 1) != 1) {
+        LOG_WARNING("Could not wake query server");
+    }
+    worker.join();
+    close(listenFd);
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    // Only the socket file this server bound, not one that replaced it
+    struct stat info;
+    if (lstat(endpoint.c_str(), &info) == 0 && S_ISSOCK(info.st_mode) &&
+        (unsigned long long)info.st_ino == socketId) {
+        unlink(endpoint.c_str());
+    }
+    listenFd = -1;
+    running = false;
+}
+
+// A client gets this long to send its request and take the response
+static const int CLIENT_TIMEOUT_MS = 1000;
+
+// Waits until client is ready for events. Returns false on stop, when
+// deadline passes or when the client hung up.
+static bool WaitClient(int client, short events, int stopFd, std::chrono::steady_clock::time_point deadline) {
+    long long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    if (left <= 0) {
+        return false;
+    }
+    pollfd fds[2] = { { client, events, 0 }, { stopFd, POLLIN, 0 } };
+    return poll(fds, 2, (int)left) > 0 && !(fds[1].revents & POLLIN) && (fds[0].revents & (events | POLLHUP));
+}
+
+void QueryServer::Serve() {
+    std::vector<char> buffer(4096);
+    for (;;) {
+        pollfd fds[2] = { { listenFd, POLLIN, 0 }, { stopPipe[0], POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN)) {
+            break;
+        }
+        int client = accept(listenFd, NULL, NULL);
+        if (client < 0) {
+            continue;
+        }
+
+        // Read up to the end of the request line. A client that stalls is
+        // dropped, so neither it nor Stop() waits on the next one.
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CLIENT_TIMEOUT_MS);
+        std::string request;
+        bool complete = false;
+        while (!complete && WaitClient(client, POLLIN, stopPipe[0], deadline)) {
+            ssize_t got = read(client, buffer.data(), buffer.size());
+            if (got <= 0) {
+                // A client may end its request by shutting down its side
+                complete = got == 0;
+                break;
+            }
+            request.append(buffer.data(), (size_t)got);
+            complete = request.find('\n') != std::string::npos || request.size() >= QueryServer::MAX_MESSAGE;
+        }
+        if (!complete) {
+            close(client);
+            continue;
+        }
+
+        std::string response = handler(TrimRequest(request));
+        size_t sent = 0;
+        ssize_t put;
+        while (sent < response.size() && WaitClient(client, POLLOUT, stopPipe[0], deadline) &&
+               (put = send(client, response.data() + sent, response.size() - sent, SEND_FLAGS)) > 0) {
+            sent += (size_t)put;
+        }
+        close(client);
+    }
+}
+
+bool SendQuery(const std::string& endpoint, const std::string& request, std::string& response) {
+    sockaddr_un address = {};
+    if (endpoint.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, endpoint.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return false;
+    }
+
+    std::string line = request + "\n";
+    bool ok = write(fd, line.data(), line.size()) == (ssize_t)line.size();
+    response.clear();
+    char buffer[4096];
+    ssize_t got;
+    while (ok && (got = read(fd, buffer, sizeof(buffer))) > 0) {
+        response.append(buffer, (size_t)got);
+    }
+    close(fd);
+    return ok;
+}
+
+#endif
+
+QueryServer::~QueryServer() {
+    Stop();
+}
@@ -0,0 +1,55 @@
+#ifndef QUERYSERVER_H
+#define QUERYSERVER_H
+
+#include <string>
+#include <thread>
+#include <functional>
+
+// Local-only request/response endpoint for other tools.
+//
+// Windows: a message-mode named pipe that rejects remote clients and only
+// admits the current user. Elsewhere: a Unix domain socket only the user
+// can open. There is no network listener.
+//
+// A request is one line of text; the response is the text the handler
+// returns. Requests are served one at a time on a background thread; on
+// the Unix socket a client that does not send its request within a second
+// is dropped.
+class QueryServer {
+public:
+    typedef std::function<std::string(const std::string& request)> Handler;
+
+    // "\\.\pipe\TimeRecording-<user SID>" on Windows,
+    // "$XDG_RUNTIME_DIR/timerecording.sock" elsewhere. Empty if unknown.
+    static std::string DefaultEndpoint();
+    static const size_t MAX_MESSAGE = 64 * 1024;
+
+    QueryServer();
+    ~QueryServer();
+
+    bool Start(const std::string& endpoint, Handler handler);
+    void Stop();
+    bool IsRunning() const { return running; }
+
+private:
+    void Serve();
+
+    std::string endpoint;
+    Handler handler;
+    std::thread worker;
+    bool running;
+#ifdef _WIN32
+    void* stopEvent;
+    void* security;  // owner-only security descriptor of the pipe
+#else
+    int listenFd;
+    int stopPipe[2];
+    unsigned long long socketId;  // inode of the bound socket file
+#endif
+};
+
+// Sends one request to a running server and waits for the response.
+// Returns false if no server is listening at endpoint.
+bool SendQuery(const std::string& endpoint, const std::string& request, std::string& response);
+
+#endif // QUERYSERVER_H
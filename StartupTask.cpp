@@ -0,0 +1,55 @@
+#include "StartupTask.h"
+#include "LogWriter.h"
+#include "LogParser.h"
+#include "LogTailScanner.h"
+#include "LogArchive.h"
+#include "IsoCalendar.h"
+#include "Tags.h"
+#include "Metrics.h"
+#include <cstdio>
+
+bool RecoverCrashRecord(const std::string& logName, const std::string& tmpName) {
+    if (!LogWriter::AppendFile(logName, tmpName)) {
+        return false;
+    }
+    std::remove(tmpName.c_str());
+    return true;
+}
+
+void ResumeDay(const std::string& logName, const std::chrono::system_clock::time_point& arriveTime,
+               const std::string& tag, StartupResult& result) {
+    // Continue counting from what was already logged today, e.g. before a
+    // restart or crash. Reads the log backwards only as far as today goes.
+    DaySummary today;
+    result.tag = tag;
+    if (LogTailScanner::SummarizeDay(logName, arriveTime, today)) {
+        result.minutesEarlierToday = today.minutesWorked;
+        // Keep booking on the project of the day unless one was given
+        if (result.tag.empty()) {
+            result.tag = TagTable::Name(today.tag);
+        }
+    } else {
+        result.minutesEarlierToday = 0;
+    }
+}
+
+void RunStartup(const StartupPlan& plan, DayRollup& rollup, WorkCalendar& calendar, StartupResult& result) {
+    METRICS_SCOPED_TIMER(TIMER_STARTUP);
+
+    RecoverCrashRecord(plan.logName, plan.tmpName);
+    if (plan.archiveBeforeDay > 0) {
+        ArchiveLogBefore(plan.logName, plan.archiveName, plan.archiveBeforeDay);
+    }
+    rollup.Load(plan.rollupName);
+    rollup.CatchUp(plan.logName, plan.archiveName);
+    rollup.Save(plan.rollupName);
+    calendar.Load(plan.calendarName);
+    ResumeDay(plan.logName, plan.arriveTime, plan.tag, result);
+
+    LogRecord arrive;
+    arrive.time = plan.arriveTime;
+    arrive.day = IsoCalendar::LocalDayNumber(plan.arriveTime);
+    arrive.kind = LogEventKind::Arrive;
+    arrive.tag = TagTable::Intern(result.tag);
+    LogWriter::WriteRecord(plan.logName, arrive);
+}
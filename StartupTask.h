@@ -0,0 +1,49 @@
+#ifndef STARTUPTASK_H
+#define STARTUPTASK_H
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include "DayRollup.h"
+#include "WorkCalendar.h"
+
+// Files and settings of one launch
+struct StartupPlan {
+    std::string logName;
+    std::string tmpName;       // crash recovery record of the last run
+    std::string rollupName;
+    std::string archiveName;
+    std::string calendarName;
+    int archiveBeforeDay;      // 0 = do not archive
+    std::chrono::system_clock::time_point arriveTime;
+    std::string tag;           // empty = continue with the tag of the day
+
+    StartupPlan() : archiveBeforeDay(0) {}
+};
+
+// What the window needs once the log I/O of the launch is done
+struct StartupResult {
+    uint32_t minutesEarlierToday;  // closed sessions of today before arriveTime
+    std::string tag;               // tag the ARRIVE was written with
+};
+
+// The log I/O of a launch, without any window handling, so it can run on a
+// background thread while the window is already shown. In log order:
+//   1. crash recovery: the LEAVE record left in tmpName is appended
+//   2. days before archiveBeforeDay move to the archive
+//   3. the rollup is loaded and catches up with the log
+//   4. the work calendar is loaded
+//   5. today's earlier minutes and tag are read from the log tail
+//   6. the ARRIVE record at arriveTime is appended
+// rollup and calendar must not be used elsewhere until it returns.
+void RunStartup(const StartupPlan& plan, DayRollup& rollup, WorkCalendar& calendar, StartupResult& result);
+
+// Step 1 alone. Returns true if a record was recovered.
+bool RecoverCrashRecord(const std::string& logName, const std::string& tmpName);
+
+// Step 5 alone: minutes logged today before arriveTime, and tag, or the tag
+// of the day if tag is empty
+void ResumeDay(const std::string& logName, const std::chrono::system_clock::time_point& arriveTime,
+               const std::string& tag, StartupResult& result);
+
+#endif // STARTUPTASK_H
@@ -0,0 +1,130 @@
+#include "SummaryRowProvider.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "BlockSource.h"
+
+LogSummaryRowProvider::LogSummaryRowProvider(const std::string& fname, SummaryGrouping group,
+                                             const SummaryWindow& range,
+                                             const std::string& archiveName,
+                                             const SessionFilter& sessionFilter)
+    : filename(fname), grouping(group), window(range), filter(sessionFilter), rowCount(0), cachedPage(-1) {
+    if (!archiveName.empty()) {
+        archive.Open(archiveName);
+    }
+    METRICS_SCOPED_TIMER(TIMER_AGGREGATE);
+    Scan(ScanPosition{ 0, 0, 0 }, [this](const SummaryRow&, const ScanPosition& rowStart) {
+        if (rowCount % PAGE_SIZE == 0) {
+            pageStarts.push_back(rowStart);
+        }
+        rowCount++;
+        return true;
+    });
+    LOG_DEBUG("Summary rows: " + std::to_string(rowCount) +
+              ", pages: " + std::to_string(pageStarts.size()));
+}
+
+void LogSummaryRowProvider::Scan(const ScanPosition& start,
+                                 const std::function<bool(const SummaryRow&, const ScanPosition&)>& onRow) {
+    size_t archiveBlocks = archive.IsOpen() ? archive.BlockCount() : 0;
+    int64_t archivedUntil = archive.IsOpen() ? archive.LastTime() : INT64_MIN;
+    LineReader file(filename, start.block < archiveBlocks ? 0 : start.offset);
+    if (!file.IsOpen()) {
+        return;
+    }
+
+    bool stop = false;
+    ScanPosition rowStart = start;
+    SummaryStream stream(grouping, window, [&](const SummaryRow& row) {
+        if (!stop && !onRow(row, rowStart)) {
+            stop = true;
+        }
+    });
+
+    SessionBuilder builder;
+    LogSession session;
+    ScanPosition arriveStart = start;
+    // A row may start with a session opened by a SWITCH, which does not open
+    // one for a builder that starts there
+    bool resume = start.block != 0 || start.record != 0 || start.offset != 0;
+
+    if (start.block < archiveBlocks) {
+        archive.ReadBlocks(start.block, [&](const LogRecord& record, size_t block, size_t position) {
+            if (block == start.block && position < start.record) {
+                return true;
+            }
+            bool closed = false;
+            if (resume) {
+                resume = false;
+                builder.Resume(record);
+            } else {
+                closed = builder.AddRecord(record, session) && filter.Apply(session);
+            }
+            // A SWITCH closes one session and starts the next
+            ScanPosition sessionStart = arriveStart;
+            if (builder.Started()) {
+                arriveStart = ScanPosition{ block, position, 0 };
+            }
+            if (closed && stream.AddSession(session)) {
+                rowStart = sessionStart;
+            }
+            return !stop;
+        });
+    }
+
+    std::string line;
+    while (!stop && file.NextLine(line)) {
+        bool closed = false;
+        if (resume) {
+            resume = false;
+            builder.Resume(line);
+        } else {
+            closed = builder.AddLine(line, session);
+        }
+        ScanPosition sessionStart = arriveStart;
+        if (builder.Started()) {
+            arriveStart = ScanPosition{ archiveBlocks, 0, file.LineOffset() };
+        }
+        // Skip sessions archived already but not yet dropped from the log
+        closed = closed &&
+            std::chrono::duration_cast<std::chrono::seconds>(session.arrive.time_since_epoch()).count() >= archivedUntil &&
+            filter.Apply(session);
+        if (closed && stream.AddSession(session)) {
+            rowStart = sessionStart;
+        }
+    }
+
+    if (!stop) {
+        stream.Finish();
+    }
+}
+
+bool LogSummaryRowProvider::LoadPage(int page) {
+    if (page == cachedPage) {
+        return true;
+    }
+    if (page < 0 || page >= (int)pageStarts.size()) {
+        return false;
+    }
+
+    pageRows.clear();
+    pageRows.reserve(PAGE_SIZE);
+    Scan(pageStarts[page], [this](const SummaryRow& row, const ScanPosition&) {
+        pageRows.push_back(row);
+        return (int)pageRows.size() < PAGE_SIZE;
+    });
+    cachedPage = page;
+    return true;
+}
+
+bool LogSummaryRowProvider::GetRow(int index, SummaryRow& row) {
+    if (index < 0 || index >= rowCount || !LoadPage(index / PAGE_SIZE)) {
+        return false;
+    }
+
+    size_t pageIndex = (size_t)(index % PAGE_SIZE);
+    if (pageIndex >= pageRows.size()) {
+        return false;
+    }
+    row = pageRows[pageIndex];
+    return true;
+}
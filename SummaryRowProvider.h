@@ -0,0 +1,68 @@
+#ifndef SUMMARYROWPROVIDER_H
+#define SUMMARYROWPROVIDER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "SummaryStream.h"
+#include "LogArchive.h"
+#include "LogQuery.h"
+
+// Random access to summary rows for virtualized views.
+// Views ask only for the rows they display; implementations decide how much
+// of the summary to keep in memory.
+class SummaryRowProvider {
+public:
+    virtual ~SummaryRowProvider() {}
+
+    virtual int GetRowCount() = 0;
+    // Returns false if index is out of range
+    virtual bool GetRow(int index, SummaryRow& row) = 0;
+};
+
+// Row provider backed directly by the log file and its archive.
+//
+// Construction makes one streaming pass that only counts rows and records the
+// position where every page of PAGE_SIZE rows starts. GetRow() seeks to the
+// page's position and re-aggregates that page alone. Memory use is one page
+// of rows plus one position per page, instead of the whole report.
+class LogSummaryRowProvider : public SummaryRowProvider {
+public:
+    static const int PAGE_SIZE = 64;
+
+    LogSummaryRowProvider(const std::string& fname, SummaryGrouping grouping,
+                          const SummaryWindow& window,
+                          const std::string& archiveName = std::string(),
+                          const SessionFilter& filter = SessionFilter());
+
+    int GetRowCount() override { return rowCount; }
+    bool GetRow(int index, SummaryRow& row) override;
+
+private:
+    // An ARRIVE or SWITCH record: archive block and record in the block, or,
+    // once the block is past the archive, byte offset in the log file
+    struct ScanPosition {
+        size_t block;
+        size_t record;
+        uint64_t offset;
+    };
+
+    // Calls onRow for every row starting with the session that starts at
+    // start, until onRow returns false or the log ends. onRow gets the
+    // position of the ARRIVE or SWITCH that started the row.
+    void Scan(const ScanPosition& start,
+              const std::function<bool(const SummaryRow&, const ScanPosition& rowStart)>& onRow);
+    bool LoadPage(int page);
+
+    std::string filename;
+    ArchiveReader archive;
+    SummaryGrouping grouping;
+    SummaryWindow window;
+    SessionFilter filter;
+    int rowCount;
+    std::vector<ScanPosition> pageStarts;
+    std::vector<SummaryRow> pageRows;
+    int cachedPage;
+};
+
+#endif // SUMMARYROWPROVIDER_H
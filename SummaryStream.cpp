@@ -0,0 +1,89 @@
+#include "SummaryStream.h"
+#include "IsoCalendar.h"
+#include <ctime>
+
+bool SummaryWindow::Contains(const std::chrono::system_clock::time_point& tp) const {
+    auto epoch = std::chrono::system_clock::time_point{};
+    if (from != epoch && tp < from) return false;
+    if (to != epoch && tp >= to) return false;
+    return true;
+}
+
+bool SummaryWindow::IsUnbounded() const {
+    auto epoch = std::chrono::system_clock::time_point{};
+    return from == epoch && to == epoch;
+}
+
+SummaryWindow SummaryWindow::All() {
+    return SummaryWindow();
+}
+
+SummaryWindow SummaryWindow::Range(const std::chrono::system_clock::time_point& from,
+                                   const std::chrono::system_clock::time_point& to) {
+    SummaryWindow window;
+    window.from = from;
+    window.to = to;
+    return window;
+}
+
+SummaryWindow SummaryWindow::LastWeeks(int weeks, const std::chrono::system_clock::time_point& now) {
+    if (weeks <= 0) {
+        return All();
+    }
+
+    std::time_t tt = std::chrono::system_clock::to_time_t(now);
+    std::tm tm = *std::localtime(&tt);
+
+    // Back to Monday 00:00 of the current week, then weeks - 1 further weeks
+    int daysSinceMonday = (tm.tm_wday + 6) % 7;
+    tm.tm_mday -= daysSinceMonday + 7 * (weeks - 1);
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+
+    SummaryWindow window;
+    window.from = std::chrono::system_clock::from_time_t(std::mktime(&tm));
+    return window;
+}
+
+SummaryStream::SummaryStream(SummaryGrouping group, const SummaryWindow& range, RowCallback callback)
+    : grouping(group), window(range), onRow(callback), currentGroup(0), hasCurrent(false), rowsEmitted(0) {
+    current.minutes = 0;
+    current.day = 0;
+}
+
+bool SummaryStream::AddSession(const LogSession& session) {
+    if (!window.Contains(session.arrive)) {
+        return false;
+    }
+
+    // Integer grouping; the key text is only built once per row
+    int group = grouping == SummaryGrouping::Daily
+        ? session.day
+        : session.day - (IsoCalendar::Weekday(session.day) - 1);
+
+    if (hasCurrent && group == currentGroup) {
+        current.minutes += session.minutes;
+        return false;
+    }
+
+    Finish();
+    currentGroup = group;
+    current.key = grouping == SummaryGrouping::Daily
+        ? IsoCalendar::DateKey(group)
+        : IsoCalendar::WeekKey(group);
+    current.minutes = session.minutes;
+    current.day = group;
+    hasCurrent = true;
+    return true;
+}
+
+void SummaryStream::Finish() {
+    if (!hasCurrent) {
+        return;
+    }
+    onRow(current);
+    rowsEmitted++;
+    hasCurrent = false;
+}
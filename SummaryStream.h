@@ -0,0 +1,65 @@
+#ifndef SUMMARYSTREAM_H
+#define SUMMARYSTREAM_H
+
+#include <string>
+#include <chrono>
+#include <functional>
+#include "LogParser.h"
+
+enum class SummaryGrouping {
+    Daily,
+    Weekly
+};
+
+// One aggregated line of a summary
+struct SummaryRow {
+    std::string key;
+    int minutes;
+    int day;  // day number of the row's day or of its week's Monday
+};
+
+// Range of session start times that contribute to a summary.
+// A default constructed window is unbounded.
+struct SummaryWindow {
+    std::chrono::system_clock::time_point from;  // inclusive, epoch = open
+    std::chrono::system_clock::time_point to;    // exclusive, epoch = open
+
+    bool Contains(const std::chrono::system_clock::time_point& tp) const;
+    bool IsUnbounded() const;
+
+    static SummaryWindow All();
+    static SummaryWindow Range(const std::chrono::system_clock::time_point& from,
+                               const std::chrono::system_clock::time_point& to);
+    // The current week and the weeks - 1 weeks before it (weeks start on Monday)
+    static SummaryWindow LastWeeks(int weeks, const std::chrono::system_clock::time_point& now);
+};
+
+// Aggregates sessions into rows and emits each row as soon as it closes.
+//
+// The log is chronological, so a row is complete once a session with a
+// different key arrives. Only the row being built is held in memory, which
+// keeps memory use constant regardless of log size.
+class SummaryStream {
+public:
+    typedef std::function<void(const SummaryRow&)> RowCallback;
+
+    SummaryStream(SummaryGrouping group, const SummaryWindow& range, RowCallback callback);
+
+    // Returns true if the session started a new row
+    bool AddSession(const LogSession& session);
+    // Emits the row still being built
+    void Finish();
+
+    int RowsEmitted() const { return rowsEmitted; }
+
+private:
+    SummaryGrouping grouping;
+    SummaryWindow window;
+    RowCallback onRow;
+    SummaryRow current;
+    int currentGroup;  // day number of the row's day or of its week's Monday
+    bool hasCurrent;
+    int rowsEmitted;
+};
+
+#endif // SUMMARYSTREAM_H
@@ -0,0 +1,122 @@
+#include "Tags.h"
+#include "Metrics.h"
+#include <unordered_map>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+
+static std::mutex tagMutex;
+static std::vector<std::string> tagNames(1);
+static std::unordered_map<std::string, int> tagIds;
+static int lastTag = TagTable::NO_TAG;
+
+int TagTable::Intern(const char* text, size_t length) {
+    if (length == 0) {
+        return NO_TAG;
+    }
+
+    std::lock_guard<std::mutex> lock(tagMutex);
+    // Consecutive records mostly carry the same tag; compare before hashing
+    const std::string& last = tagNames[lastTag];
+    if (last.size() == length && std::memcmp(last.data(), text, length) == 0) {
+        return lastTag;
+    }
+
+    std::string name(text, length);
+    auto it = tagIds.find(name);
+    if (it == tagIds.end()) {
+        it = tagIds.emplace(name, (int)tagNames.size()).first;
+        tagNames.push_back(name);
+    }
+    lastTag = it->second;
+    return lastTag;
+}
+
+std::string TagTable::Name(int tag) {
+    std::lock_guard<std::mutex> lock(tagMutex);
+    return tag >= 0 && tag < (int)tagNames.size() ? tagNames[tag] : std::string();
+}
+
+int TagTable::Count() {
+    std::lock_guard<std::mutex> lock(tagMutex);
+    return (int)tagNames.size();
+}
+
+std::string TagTable::Sanitize(const std::string& name) {
+    std::string result;
+    for (char c : name) {
+        if (c != ',' && c != '\r' && c != '\n') {
+            result.push_back(c);
+        }
+    }
+    size_t first = result.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return std::string();
+    }
+    size_t last = result.find_last_not_of(" \t");
+    return result.substr(first, last - first + 1);
+}
+
+TagDayMatrix::TagDayMatrix()
+    : baseDay(0), dayCount(0), tagCount(0), dayCapacity(0), tagCapacity(0) {
+}
+
+void TagDayMatrix::Reserve(int day, int tag) {
+    int newBase = dayCount == 0 ? day : std::min(baseDay, day);
+    int newLast = dayCount == 0 ? day : std::max(LastDay(), day);
+    int newDayCapacity = std::max(dayCapacity, 1);
+    while (newDayCapacity < newLast - newBase + 1) {
+        newDayCapacity *= 2;
+    }
+    int newTagCapacity = std::max(tagCapacity, 4);
+    while (newTagCapacity <= tag) {
+        newTagCapacity *= 2;
+    }
+
+    if (newBase != baseDay || newDayCapacity != dayCapacity || newTagCapacity != tagCapacity) {
+        std::vector<int32_t> newCells((size_t)newDayCapacity * newTagCapacity, 0);
+        for (int d = 0; d < dayCount; d++) {
+            for (int t = 0; t < tagCount; t++) {
+                newCells[(size_t)(d + baseDay - newBase) * newTagCapacity + t] =
+                    cells[(size_t)d * tagCapacity + t];
+            }
+        }
+        cells.swap(newCells);
+        dayCapacity = newDayCapacity;
+        tagCapacity = newTagCapacity;
+    }
+
+    baseDay = newBase;
+    dayCount = newLast - newBase + 1;
+    if (tag >= tagCount) {
+        tagCount = tag + 1;
+        tagTotals.resize(tagCount, 0);
+    }
+}
+
+void TagDayMatrix::Add(const LogSession& session) {
+    if (dayCount == 0 || session.day < baseDay || session.day > LastDay() || session.tag >= tagCount) {
+        Reserve(session.day, session.tag);
+    }
+    cells[(size_t)(session.day - baseDay) * tagCapacity + session.tag] += session.minutes;
+    tagTotals[session.tag] += session.minutes;
+}
+
+int TagDayMatrix::Minutes(int tag, int day) const {
+    if (tag < 0 || tag >= tagCount || day < baseDay || day > LastDay()) {
+        return 0;
+    }
+    return cells[(size_t)(day - baseDay) * tagCapacity + tag];
+}
+
+int64_t TagDayMatrix::TagTotal(int tag) const {
+    return tag >= 0 && tag < tagCount ? tagTotals[tag] : 0;
+}
+
+bool BuildTagDayMatrix(const std::string& logName, const std::string& archiveName,
+                       const SessionFilter& filter, TagDayMatrix& matrix) {
+    METRICS_SCOPED_TIMER(TIMER_AGGREGATE);
+    return ScanFilteredSessions(logName, archiveName, filter, [&matrix](const LogSession& session) {
+        matrix.Add(session);
+    });
+}
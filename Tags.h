@@ -0,0 +1,65 @@
+#ifndef TAGS_H
+#define TAGS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "LogParser.h"
+#include "LogQuery.h"
+
+// Process-wide table of project tags.
+//
+// Tag names are interned once when a record is parsed; everything after
+// that works with dense integer IDs in order of first appearance. ID 0 is
+// the empty tag of records written without one. Names are UTF-8, as in the
+// log; the window converts them to and from UTF-16.
+class TagTable {
+public:
+    static const int NO_TAG = 0;
+
+    static int Intern(const char* text, size_t length);
+    static int Intern(const std::string& name) { return Intern(name.data(), name.size()); }
+    static std::string Name(int tag);
+    // Number of IDs handed out so far, including NO_TAG
+    static int Count();
+
+    // Tag as it can be written to the log: no commas or line breaks, no
+    // surrounding blanks
+    static std::string Sanitize(const std::string& name);
+};
+
+// Minutes per tag and day, filled in one pass over the sessions.
+//
+// Cells are stored day by day in one array with a row stride of
+// tagCapacity, so adding a session is plain index arithmetic.
+class TagDayMatrix {
+public:
+    TagDayMatrix();
+
+    void Add(const LogSession& session);
+
+    bool IsEmpty() const { return dayCount == 0; }
+    int FirstDay() const { return baseDay; }
+    int LastDay() const { return baseDay + dayCount - 1; }
+    int TagCount() const { return tagCount; }
+
+    int Minutes(int tag, int day) const;
+    int64_t TagTotal(int tag) const;
+
+private:
+    void Reserve(int day, int tag);
+
+    int baseDay;
+    int dayCount;
+    int tagCount;
+    int dayCapacity;
+    int tagCapacity;
+    std::vector<int32_t> cells;       // [(day - baseDay) * tagCapacity + tag]
+    std::vector<int64_t> tagTotals;   // indexed by tag
+};
+
+// Aggregates the archived and logged sessions that pass filter
+bool BuildTagDayMatrix(const std::string& logName, const std::string& archiveName,
+                       const SessionFilter& filter, TagDayMatrix& matrix);
+
+#endif // TAGS_H
@@ -1,32 +1,134 @@
 #include "TimeTracker.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "LogWriter.h"
+#include "LogParser.h"
+#include "SummaryStream.h"
+#include "SummaryRowProvider.h"
+#include "LogArchive.h"
+#include "Tags.h"
+#include "IsoCalendar.h"
+#include "QueryProtocol.h"
+#include "WorkCalendar.h"
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <memory>
 #include <shellapi.h>
+#include <commctrl.h>
 #include <iostream>
 
 
-// Debug helper function for Windows GUI apps
-void DebugOutput(const std::string& message) {
-    #ifdef _DEBUG
-    // Write to debug output (visible in Visual Studio Output window)
-    OutputDebugStringA((message + "\n").c_str());
+// State of one open summary dialog, owned by the dialog window
+struct SummaryDialogState {
+    std::unique_ptr<SummaryRowProvider> provider;
+    std::wstring keyPrefix;  // e.g. "Week " in weekly summaries
+    std::wstring hoursText;
+    const WorkCalendar* calendar;  // NULL = no target columns
+    const DayRollup* rollup;
+    int rowDays;                   // 1 for daily, 7 for weekly rows
+    int today;
+    HWND hHeader;
+    HWND hList;
+    HWND hOkButton;
+};
+
+static void LayoutSummaryDialog(HWND hDlg, SummaryDialogState* state) {
+    RECT clientRect;
+    GetClientRect(hDlg, &clientRect);
+    MoveWindow(state->hHeader, 10, 10, clientRect.right - 20, 24, TRUE);
+    MoveWindow(state->hList, 10, 40, clientRect.right - 20, clientRect.bottom - 90, TRUE);
+    MoveWindow(state->hOkButton, (clientRect.right - 80) / 2, clientRect.bottom - 40, 80, 30, TRUE);
+}
+
+// "7:05", or "+7:05" / "-0:30" with sign
+static std::string FormatMinutes(int64_t minutes, bool withSign) {
+    std::string sign = minutes < 0 ? "-" : (withSign ? "+" : "");
+    int64_t magnitude = minutes < 0 ? -minutes : minutes;
+    int64_t rest = magnitude % 60;
+    return sign + std::to_string(magnitude / 60) + ":" + (rest < 10 ? "0" : "") + std::to_string(rest);
+}
 
-    // Also write to a debug log file
-    std::ofstream debugFile("debug_log.txt", std::ios::app);
-    debugFile << message << std::endl;
-    debugFile.close();
-    #endif
+// Target, balance and running flex-time of a summary row. Days after today
+// have no target yet.
+struct RowBalance {
+    int64_t target;
+    int64_t balance;
+    int64_t flex;
+    bool hasFlex;
+};
+
+static RowBalance ComputeRowBalance(const WorkCalendar& calendar, const DayRollup& rollup,
+                                    const SummaryRow& row, int rowDays, int today) {
+    int lastDay = (std::min)(row.day + rowDays - 1, today);  // parenthesized against the windows.h macro
+    RowBalance result;
+    result.target = calendar.TargetMinutes(row.day, lastDay);
+    result.balance = row.minutes - result.target;
+    result.hasFlex = calendar.FlexBalance(rollup, lastDay, result.flex);
+    return result;
+}
+
+// Fills the text of one visible list view cell from the row provider
+static void GetSummaryCellText(SummaryDialogState* state, NMLVDISPINFOW* dispInfo) {
+    if (!(dispInfo->item.mask & LVIF_TEXT) || dispInfo->item.cchTextMax <= 0) {
+        return;
+    }
+
+    SummaryRow row;
+    if (!state->provider->GetRow(dispInfo->item.iItem, row)) {
+        dispInfo->item.pszText[0] = L'\0';
+        return;
+    }
+
+    std::wstring text;
+    if (dispInfo->item.iSubItem == 0) {
+        text = state->keyPrefix + std::wstring(row.key.begin(), row.key.end());
+    } else if (dispInfo->item.iSubItem == 1) {
+        text = std::to_wstring(row.minutes / 60) + L":" +
+            (row.minutes % 60 < 10 ? L"0" : L"") + std::to_wstring(row.minutes % 60) +
+            L" " + state->hoursText;
+    } else if (state->calendar) {
+        RowBalance balance = ComputeRowBalance(*state->calendar, *state->rollup, row, state->rowDays, state->today);
+        std::string cell;
+        if (dispInfo->item.iSubItem == 2) {
+            cell = FormatMinutes(balance.target, false);
+        } else if (dispInfo->item.iSubItem == 3) {
+            cell = FormatMinutes(balance.balance, true);
+        } else if (balance.hasFlex) {
+            cell = FormatMinutes(balance.flex, true);
+        }
+        text = std::wstring(cell.begin(), cell.end());
+    }
+    lstrcpynW(dispInfo->item.pszText, text.c_str(), dispInfo->item.cchTextMax);
 }
 
 // Window procedure for summary dialog
 LRESULT CALLBACK SummaryDialogProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
+    SummaryDialogState* state = (SummaryDialogState*)GetWindowLongPtrW(hWnd, GWLP_USERDATA);
+
     switch (uMsg) {
         case WM_CLOSE:
             DestroyWindow(hWnd);
             return 0;
         case WM_DESTROY:
             return 0;
+        case WM_NCDESTROY:
+            SetWindowLongPtrW(hWnd, GWLP_USERDATA, 0);
+            delete state;
+            return DefWindowProcW(hWnd, uMsg, wParam, lParam);
+        case WM_SIZE:
+            if (state) {
+                LayoutSummaryDialog(hWnd, state);
+            }
+            return 0;
+        case WM_NOTIFYFORMAT:
+            return NFR_UNICODE;
+        case WM_NOTIFY:
+            if (state && ((NMHDR*)lParam)->code == LVN_GETDISPINFOW) {
+                GetSummaryCellText(state, (NMLVDISPINFOW*)lParam);
+                return 0;
+            }
+            break;
         case WM_COMMAND:
             if (LOWORD(wParam) == IDOK || LOWORD(wParam) == IDCANCEL) {
                 DestroyWindow(hWnd);
@@ -34,23 +136,88 @@ LRESULT CALLBACK SummaryDialogProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM l
             }
             break;
         default:
-            return DefWindowProc(hWnd, uMsg, wParam, lParam);
+            return DefWindowProcW(hWnd, uMsg, wParam, lParam);
     }
-    return 0;
+    return DefWindowProcW(hWnd, uMsg, wParam, lParam);
 }
 
 TimeTracker::TimeTracker(Localization* loc)
-    : minutesHibernation(0), isArrived(false), localization(loc) {
+    : hComboTag(NULL), minutesHibernation(0), minutesEarlierToday(0), isArrived(false), startupDone(false),
+      localization(loc) {
+}
+
+TimeTracker::~TimeTracker() {
+    if (startupTask.joinable()) {
+        startupTask.join();
+    }
+    for (auto& font : fonts) {
+        DeleteObject(font.second);
+    }
 }
 
 void TimeTracker::Initialize(HWND hwnd) {
     hWnd = hwnd;
     CreateControls();
-    CheckCrashRecovery();
-    Arrive();
+
+    // The window shows the arrival right away; everything that reads or
+    // writes the log runs on the startup task. Until it is done, the buttons
+    // that need the log stay disabled and no timer writes the crash record.
+    arriveTime = std::chrono::system_clock::now();
+    SetWindowTextW(hLabelArrival, TimeToWString(arriveTime).c_str());
+    EnableWindow(hBtnArrive, FALSE);
+    EnableWindow(hBtnLeave, FALSE);
+    EnableWindow(hBtnDaily, FALSE);
+    EnableWindow(hBtnWeekly, FALSE);
+    EnableWindow(hBtnTags, FALSE);
+    EnableWindow(hBtnSwitchTag, FALSE);
+
+    StartupPlan plan;
+    plan.logName = filename;
+    plan.tmpName = filenameTmp;
+    plan.rollupName = filenameRollup;
+    plan.archiveName = filenameArchive;
+    plan.calendarName = filenameCalendar;
+    plan.archiveBeforeDay = archiveBeforeDay;
+    plan.arriveTime = arriveTime;
+    plan.tag = activeTag;
+    HWND window = hWnd;
+    startupTask = std::thread([this, plan, window]() {
+        RunStartup(plan, rollup, calendar, startupResult);
+        PostMessageW(window, WM_APP_STARTED, 0, 0);
+    });
+}
+
+void TimeTracker::OnStartupComplete() {
+    startupTask.join();
+    startupDone = true;
+
+    minutesEarlierToday = startupResult.minutesEarlierToday;
+    activeTag = startupResult.tag;
+    EnableWindow(hBtnDaily, TRUE);
+    EnableWindow(hBtnWeekly, TRUE);
+    EnableWindow(hBtnTags, TRUE);
+    EnableWindow(hBtnSwitchTag, TRUE);
+    ShowArrived();
+
     lastActiveTime = arriveTime;
     SetTimer(hWnd, ID_TIMER, TIMER_INTERVAL, NULL);
     OnTimer(); // Initial update
+
+    if (!queryEndpoint.empty()) {
+        // The handler runs on the server thread; the state lives on the UI
+        // thread. The timeout keeps the server from blocking a closing window.
+        HWND window = hWnd;
+        queryServer.Start(queryEndpoint, [window](const std::string& request) {
+            auto call = std::make_shared<QueryCall>(request);
+            auto uiReference = new std::shared_ptr<QueryCall>(call);
+            if (!PostMessageW(window, WM_APP_QUERY, 0, (LPARAM)uiReference)) {
+                delete uiReference;
+                return std::string("error=busy\n");
+            }
+            std::string response;
+            return call->Wait(1000, response) ? response : std::string("error=busy\n");
+        });
+    }
 }
 
 HWND TimeTracker::CreateTextControl(const std::wstring& text, int x, int y, int width, int height, DWORD style) {
@@ -66,11 +233,22 @@ HWND TimeTracker::CreateButtonControl(const std::wstring& text, int x, int y, in
         hWnd, (HMENU)controlId, GetModuleHandle(NULL), NULL);
 }
 
-void TimeTracker::SetControlFont(HWND hControl, int fontSize, bool bold, const wchar_t* fontName) {
+HFONT TimeTracker::GetFont(int fontSize, bool bold, const wchar_t* fontName) {
+    // Created once per size, weight and face; deleted with the tracker
+    auto key = std::make_tuple(fontSize, bold, std::wstring(fontName));
+    auto it = fonts.find(key);
+    if (it != fonts.end()) {
+        return it->second;
+    }
     HFONT hFont = CreateFontW(fontSize, 0, 0, 0, bold ? FW_BOLD : FW_NORMAL,
         FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_OUTLINE_PRECIS,
         CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, VARIABLE_PITCH, fontName);
-    SendMessage(hControl, WM_SETFONT, (WPARAM)hFont, TRUE);
+    fonts[key] = hFont;
+    return hFont;
+}
+
+void TimeTracker::SetControlFont(HWND hControl, int fontSize, bool bold, const wchar_t* fontName) {
+    SendMessage(hControl, WM_SETFONT, (WPARAM)GetFont(fontSize, bold, fontName), TRUE);
 }
 
 void TimeTracker::SetButtonFont(HWND hButton) {
@@ -91,9 +269,16 @@ void TimeTracker::CreateControls() {
     hBtnLeave = CreateButtonControl(localization->Get("BTN_LEAVE"), 20, 180, 240, 35, ID_BTN_LEAVE);
     hBtnDaily = CreateButtonControl(localization->Get("BTN_DAILY_SUMMARY"), 20, 230, 240, 35, ID_BTN_DAILY);
     hBtnWeekly = CreateButtonControl(localization->Get("BTN_WEEKLY_SUMMARY"), 20, 270, 240, 35, ID_BTN_WEEKLY);
-    hBtnOpenLog = CreateButtonControl(localization->Get("BTN_OPEN_LOG"), 20, 320, 240, 35, ID_BTN_OPENLOG);
-    hBtnAbout = CreateButtonControl(localization->Get("BTN_INFO"), 20, 360, 240, 35, ID_BTN_ABOUT);
-    hBtnClose = CreateButtonControl(localization->Get("BTN_CLOSE"), 20, 400, 240, 35, ID_BTN_CLOSE);
+    hBtnTags = CreateButtonControl(localization->Get("BTN_TAG_SUMMARY"), 20, 310, 240, 35, ID_BTN_TAGS);
+    hBtnOpenLog = CreateButtonControl(localization->Get("BTN_OPEN_LOG"), 20, 360, 240, 35, ID_BTN_OPENLOG);
+    hBtnAbout = CreateButtonControl(localization->Get("BTN_INFO"), 20, 400, 240, 35, ID_BTN_ABOUT);
+    hBtnClose = CreateButtonControl(localization->Get("BTN_CLOSE"), 20, 440, 240, 35, ID_BTN_CLOSE);
+
+    // Project tag: type a new one or pick a known one, then switch
+    hComboTag = CreateWindowW(L"COMBOBOX", L"",
+        WS_VISIBLE | WS_CHILD | WS_VSCROLL | CBS_DROPDOWN | CBS_AUTOHSCROLL,
+        20, 490, 150, 200, hWnd, (HMENU)ID_CMB_TAG, GetModuleHandle(NULL), NULL);
+    hBtnSwitchTag = CreateButtonControl(localization->Get("BTN_SWITCH_TAG"), 175, 489, 85, 27, ID_BTN_SWITCH_TAG);
 
     // Set fonts
     SetControlFont(hLabelArrivalCaption, 20, true, L"Arial");
@@ -103,22 +288,12 @@ void TimeTracker::CreateControls() {
     SetButtonFont(hBtnLeave);
     SetButtonFont(hBtnDaily);
     SetButtonFont(hBtnWeekly);
+    SetButtonFont(hBtnTags);
     SetButtonFont(hBtnOpenLog);
     SetButtonFont(hBtnAbout);
     SetButtonFont(hBtnClose);
-}
-
-void TimeTracker::CheckCrashRecovery() {
-    std::ifstream tmp(filenameTmp);
-    if (tmp.good()) {
-        tmp.close();
-        std::ifstream tmpRead(filenameTmp);
-        std::ofstream log(filename, std::ios::app);
-        log << tmpRead.rdbuf();
-        tmpRead.close();
-        log.close();
-        DeleteFileA(filenameTmp.c_str());
-    }
+    SetControlFont(hComboTag, 16, false, L"Arial");
+    SetButtonFont(hBtnSwitchTag);
 }
 
 void TimeTracker::OnTimer() {
@@ -128,17 +303,16 @@ void TimeTracker::OnTimer() {
 
     if (secondsSinceLastTimer > HIBERNATION_THRESHOLD) {
         // Hibernation detected
-        WriteEvent(lastActiveTime, filename, localization->GetLogEvent("LOG_LEAVE_HIBERNATION"));
-        WriteEvent(currentTime, filename, localization->GetLogEvent("LOG_ARRIVE_HIBERNATION"));
+        WriteEvent(lastActiveTime, filename, LogEventKind::LeaveHibernation);
+        WriteEvent(currentTime, filename, LogEventKind::ArriveHibernation);
+        UpdateRollup();
 
         minutesHibernation += std::chrono::duration_cast<std::chrono::minutes>(
             currentTime - lastActiveTime).count();
     }
 
     if (isArrived) {
-        uint64_t minsActive = std::chrono::duration_cast<std::chrono::minutes>(
-            currentTime - arriveTime).count();
-        minsActive -= minutesHibernation;
+        uint64_t minsActive = MinutesToday(currentTime);
 
         // Update time display
         std::wstring timeStr = std::to_wstring(minsActive / 60) + L":" +
@@ -147,14 +321,32 @@ void TimeTracker::OnTimer() {
     }
 
     // Write to temp file for crash recovery
-    WriteEvent(currentTime, filenameTmp, localization->GetLogEvent("LOG_LEAVE_TERMINATED"), false);
+    WriteEvent(currentTime, filenameTmp, LogEventKind::LeaveTerminated, false);
 
     lastActiveTime = currentTime;
 }
 
+uint64_t TimeTracker::MinutesToday(const std::chrono::system_clock::time_point& now) const {
+    uint64_t minsActive = std::chrono::duration_cast<std::chrono::minutes>(now - arriveTime).count();
+    minsActive -= minutesHibernation;
+    minsActive += minutesEarlierToday;
+    return minsActive;
+}
+
 void TimeTracker::Arrive() {
     arriveTime = std::chrono::system_clock::now();
-    WriteEvent(arriveTime, filename, localization->GetLogEvent("LOG_ARRIVE"));
+
+    StartupResult today;
+    ResumeDay(filename, arriveTime, activeTag, today);
+    minutesEarlierToday = today.minutesEarlierToday;
+    activeTag = today.tag;
+
+    WriteEvent(arriveTime, filename, LogEventKind::Arrive);
+    ShowArrived();
+}
+
+void TimeTracker::ShowArrived() {
+    SetWindowTextW(hComboTag, StringToWString(activeTag).c_str());
 
     std::wstring arrivalStr = TimeToWString(arriveTime);
     SetWindowTextW(hLabelArrival, arrivalStr.c_str());
@@ -166,7 +358,8 @@ void TimeTracker::Arrive() {
 }
 
 void TimeTracker::Leave() {
-    WriteEvent(std::chrono::system_clock::now(), filename, localization->GetLogEvent("LOG_LEAVE"));
+    WriteEvent(std::chrono::system_clock::now(), filename, LogEventKind::Leave);
+    UpdateRollup();
     EnableWindow(hBtnArrive, TRUE);
     EnableWindow(hBtnLeave, FALSE);
     isArrived = false;
@@ -181,55 +374,143 @@ void TimeTracker::ShowWeeklySummary() {
     ShowSummaryDialog(false);
 }
 
-void TimeTracker::ShowSummaryDialog(bool daily) {
+void TimeTracker::ShowTagSummary() {
+    std::wstring summary = StringToWString(GenerateTagSummary());
+    std::wstring title = localization->Get("TAG_SUMMARY_TITLE");
+
+    // Plain text; without a state the summary dialog only closes on OK
+    RegisterSummaryDialogClass();
+    HWND hDlg = CreateWindowW(L"SummaryDialogClass", title.c_str(),
+        WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+        CW_USEDEFAULT, CW_USEDEFAULT, 600, 400,
+        hWnd, NULL, GetModuleHandle(NULL), NULL);
+    if (!hDlg) {
+        return;
+    }
+
+    RECT clientRect;
+    GetClientRect(hDlg, &clientRect);
+    HWND hText = CreateWindowW(L"EDIT", summary.c_str(),
+        WS_VISIBLE | WS_CHILD | WS_VSCROLL | WS_HSCROLL | ES_MULTILINE | ES_READONLY,
+        10, 10, clientRect.right - 20, clientRect.bottom - 60,
+        hDlg, NULL, GetModuleHandle(NULL), NULL);
+    HWND hOkButton = CreateWindowW(L"BUTTON", L"OK",
+        WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+        (clientRect.right - 80) / 2, clientRect.bottom - 40, 80, 30,
+        hDlg, (HMENU)IDOK, GetModuleHandle(NULL), NULL);
+
+    SetControlFont(hText, summaryFontSize, false, L"Courier New");
+    SetButtonFont(hOkButton);
+    SetFocus(hOkButton);
+}
+
+// Unicode class, so that the list view sends LVN_GETDISPINFOW
+void TimeTracker::RegisterSummaryDialogClass() {
     static bool dialogClassRegistered = false;
 
-    // Register dialog window class if not already registered
     if (!dialogClassRegistered) {
-        WNDCLASS wc = {};
+        WNDCLASSW wc = {};
         wc.lpfnWndProc = SummaryDialogProc;
         wc.hInstance = GetModuleHandle(NULL);
-        wc.lpszClassName = "SummaryDialogClass";
+        wc.lpszClassName = L"SummaryDialogClass";
         wc.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
         wc.hCursor = LoadCursor(NULL, IDC_ARROW);
         wc.hIcon = LoadIcon(NULL, IDI_APPLICATION);
 
-        if (RegisterClass(&wc)) {
+        if (RegisterClassW(&wc)) {
             dialogClassRegistered = true;
         }
     }
+}
+
+void TimeTracker::ShowSummaryDialog(bool daily) {
+    RegisterSummaryDialogClass();
+
+    // Only counts rows and indexes pages; row text is produced on demand
+    SummaryDialogState* state = new SummaryDialogState();
+    state->provider.reset(new LogSummaryRowProvider(filename,
+        daily ? SummaryGrouping::Daily : SummaryGrouping::Weekly, GetSummaryWindow(), filenameArchive, summaryFilter));
+    state->keyPrefix = daily ? L"" : localization->Get("WEEK") + L" ";
+    state->hoursText = localization->Get("HOURS");
+    state->calendar = calendar.IsConfigured() ? &calendar : NULL;
+    state->rollup = &rollup;
+    state->rowDays = daily ? 1 : 7;
+    state->today = IsoCalendar::LocalDayNumber(std::chrono::system_clock::now());
+    int rowCount = state->provider->GetRowCount();
 
-    auto summary = daily ? GenerateDailySummary() : GenerateWeeklySummary();
     std::wstring title = daily ? localization->Get("DAILY_SUMMARY_TITLE") : localization->Get("WEEKLY_SUMMARY_TITLE");
+    std::wstring header = (daily ? localization->Get("DAILY_SUMMARY_HEADER") : localization->Get("WEEKLY_SUMMARY_HEADER")) +
+        L"   Number of entries: " + std::to_wstring(rowCount);
+    METRICS_SCOPED_TIMER(TIMER_RENDER);
 
     // Create proper dialog window
     HWND hDlg = CreateWindowW(L"SummaryDialogClass", title.c_str(),
         WS_OVERLAPPEDWINDOW | WS_VISIBLE,
-        CW_USEDEFAULT, CW_USEDEFAULT, 600, 300,
+        CW_USEDEFAULT, CW_USEDEFAULT, 600, 400,
         hWnd, NULL, GetModuleHandle(NULL), NULL);
 
-    if (hDlg) {
-        // Create text area with proper sizing
-        RECT clientRect;
-        GetClientRect(hDlg, &clientRect);
+    if (!hDlg) {
+        delete state;
+        return;
+    }
+
+    state->hHeader = CreateWindowW(L"STATIC", header.c_str(),
+        WS_VISIBLE | WS_CHILD | SS_LEFT,
+        0, 0, 0, 0, hDlg, NULL, GetModuleHandle(NULL), NULL);
+
+    // Owner-data report view: the list only stores the row count and asks
+    // for the text of visible cells through LVN_GETDISPINFOW
+    state->hList = CreateWindowExW(WS_EX_CLIENTEDGE, WC_LISTVIEWW, L"",
+        WS_VISIBLE | WS_CHILD | LVS_REPORT | LVS_OWNERDATA | LVS_SINGLESEL,
+        0, 0, 0, 0, hDlg, NULL, GetModuleHandle(NULL), NULL);
+
+    state->hOkButton = CreateWindowW(L"BUTTON", L"OK",
+        WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+        0, 0, 0, 0, hDlg, (HMENU)IDOK, GetModuleHandle(NULL), NULL);
+
+    SendMessageW(state->hList, LVM_SETEXTENDEDLISTVIEWSTYLE, 0, LVS_EX_FULLROWSELECT);
+
+    std::wstring keyColumn = daily ? localization->Get("SUMMARY_COLUMN_DAY") : localization->Get("WEEK");
+    std::wstring timeColumn = localization->Get("SUMMARY_COLUMN_TIME");
+    LVCOLUMNW column = {};
+    column.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_SUBITEM;
+    column.cx = state->calendar ? 150 : 260;
+    column.pszText = &keyColumn[0];
+    column.iSubItem = 0;
+    SendMessageW(state->hList, LVM_INSERTCOLUMNW, 0, (LPARAM)&column);
+    column.cx = state->calendar ? 120 : 260;
+    column.pszText = &timeColumn[0];
+    column.iSubItem = 1;
+    SendMessageW(state->hList, LVM_INSERTCOLUMNW, 1, (LPARAM)&column);
+
+    // Target hours from the work calendar
+    if (state->calendar) {
+        const char* balanceColumns[] = { "SUMMARY_COLUMN_TARGET", "SUMMARY_COLUMN_BALANCE", "SUMMARY_COLUMN_FLEX" };
+        for (int i = 0; i < 3; i++) {
+            std::wstring columnText = localization->Get(balanceColumns[i]);
+            column.cx = 90;
+            column.pszText = &columnText[0];
+            column.iSubItem = 2 + i;
+            SendMessageW(state->hList, LVM_INSERTCOLUMNW, 2 + i, (LPARAM)&column);
+        }
+    }
 
-        HWND hText = CreateWindowW(L"EDIT", std::wstring(summary.begin(), summary.end()).c_str(),
-            WS_VISIBLE | WS_CHILD | WS_VSCROLL | WS_HSCROLL | ES_MULTILINE | ES_READONLY,
-            10, 10, clientRect.right - 20, clientRect.bottom - 60,
-            hDlg, NULL, GetModuleHandle(NULL), NULL);
+    SetControlFont(state->hHeader, 16, true, L"Arial");
+    SetControlFont(state->hList, summaryFontSize, false, L"Courier New");
+    SetButtonFont(state->hOkButton);
 
-        // Create OK button
-        HWND hOkButton = CreateWindowW(L"BUTTON", L"OK",
-            WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
-            (clientRect.right - 80) / 2, clientRect.bottom - 40, 80, 30,
-            hDlg, (HMENU)IDOK, GetModuleHandle(NULL), NULL);
+    SetWindowLongPtrW(hDlg, GWLP_USERDATA, (LONG_PTR)state);
+    LayoutSummaryDialog(hDlg, state);
 
-        SetControlFont(hText, summaryFontSize, false, L"Courier New");
-        SetButtonFont(hOkButton);
+    SendMessageW(state->hList, LVM_SETITEMCOUNT, (WPARAM)rowCount, LVSICF_NOINVALIDATEALL);
 
-        // Set focus to the OK button
-        SetFocus(hOkButton);
+    // Most recent entries are the interesting ones
+    if (rowCount > 0) {
+        SendMessageW(state->hList, LVM_ENSUREVISIBLE, (WPARAM)(rowCount - 1), FALSE);
     }
+
+    // Set focus to the OK button
+    SetFocus(state->hOkButton);
 }
 
 std::string TimeTracker::WStringToString(const std::wstring& wstr) const {
@@ -244,228 +525,137 @@ std::string TimeTracker::WStringToString(const std::wstring& wstr) const {
     return strTo;
 }
 
-std::string TimeTracker::GenerateDailySummary() {
-    std::map<std::string, int> dailyMinutes;
-    ParseLogFile(dailyMinutes, true);
-
-    std::stringstream ss;
-    std::wstring header = localization->Get("DAILY_SUMMARY_HEADER");
-    ss << WStringToString(header) << " \r\n\r\n";
-
-    std::wstring hoursText = localization->Get("HOURS");
-    std::string hoursStr = WStringToString(hoursText);
-
-    ss << "Number of entries: " << dailyMinutes.size() << "\r\n\r\n";
-
-    for (const auto& entry : dailyMinutes) {
-        int hours = entry.second / 60;
-        int minutes = entry.second % 60;
-        ss << entry.first << ": " << hours << ":"
-           << std::setfill('0') << std::setw(2) << minutes << " " << hoursStr << "\r\n";
+std::wstring TimeTracker::StringToWString(const std::string& str) const {
+    if (str.empty()) {
+        return std::wstring();
     }
 
-    return ss.str();
+    int size_needed = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
+    std::wstring wstrTo(size_needed, 0);
+    MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], size_needed);
+    return wstrTo;
 }
 
-std::string TimeTracker::GenerateWeeklySummary() {
-    std::map<std::string, int> weeklyMinutes;
-    ParseLogFile(weeklyMinutes, false);
+std::string TimeTracker::GenerateTagSummary() {
+    std::string hoursStr = WStringToString(localization->Get("HOURS"));
+    std::string noTagStr = WStringToString(localization->Get("NO_TAG"));
 
-    std::stringstream ss;
-    std::wstring header = localization->Get("WEEKLY_SUMMARY_HEADER");
-    ss << WStringToString(header) << " \r\n\r\n";
-
-    std::wstring weekText = localization->Get("WEEK");
-    std::string weekStr = WStringToString(weekText);
-    std::wstring hoursText = localization->Get("HOURS");
-    std::string hoursStr = WStringToString(hoursText);
-    ss << "Number of entries: " << weeklyMinutes.size() << "\r\n\r\n";
-    for (const auto& entry : weeklyMinutes) {
-        int hours = entry.second / 60;
-        int minutes = entry.second % 60;
-        ss << weekStr << " " << entry.first << ": " << hours << ":"
-           << std::setfill('0') << std::setw(2) << minutes << " " << hoursStr << "\r\n";
-    }
+    // One pass builds the whole matrix; rows are then read by integer IDs
+    TagDayMatrix matrix;
+    BuildTagDayMatrix(filename, filenameArchive, summaryFilter, matrix);
 
-    return ss.str();
-}
-
-void TimeTracker::ParseLogFile(std::map<std::string, int>& summary, bool daily) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        DebugOutput("Could not open log file: " + filename);
-        return;
+    std::stringstream ss;
+    ss << WStringToString(localization->Get("TAG_SUMMARY_HEADER")) << " \r\n\r\n";
+    for (int tag = 0; tag < matrix.TagCount(); tag++) {
+        int64_t total = matrix.TagTotal(tag);
+        if (total > 0) {
+            std::string name = tag == TagTable::NO_TAG ? noTagStr : TagTable::Name(tag);
+            ss << name << ": " << total / 60 << ":" << std::setfill('0') << std::setw(2) << total % 60
+               << " " << hoursStr << "\r\n";
+        }
     }
-
-    std::string line;
-    std::chrono::system_clock::time_point arriveTime;
-    bool arrived = false;
-    int totalLines = 0;
-    int processedArrivals = 0;
-    int processedDepartures = 0;
-
-    DebugOutput("Starting to parse log file: " + filename);
-
-    while (std::getline(file, line)) {
-        totalLines++;
-
-        DebugOutput("Processing line " + std::to_string(totalLines) + ": " + line);
-
-        // More flexible string matching - check if line contains ARRIVE or LEAVE
-        bool isArriveEvent = (line.find("ARRIVE") != std::string::npos);
-        bool isLeaveEvent = (line.find("LEAVE") != std::string::npos);
-
-        if (isArriveEvent && !arrived) {
-            arriveTime = ParseTimeFromLine(line);
-
-            // Check if time parsing was successful
-            auto epoch = std::chrono::system_clock::time_point{};
-            if (arriveTime != epoch) {
-                arrived = true;
-                processedArrivals++;
-
-                DebugOutput("Recorded arrival at: " + TimeToString(arriveTime));
+    ss << "\r\n";
+
+    for (int day = matrix.FirstDay(); !matrix.IsEmpty() && day <= matrix.LastDay(); day++) {
+        bool first = true;
+        for (int tag = 0; tag < matrix.TagCount(); tag++) {
+            int minutes = matrix.Minutes(tag, day);
+            if (minutes == 0) {
+                continue;
             }
+            ss << (first ? IsoCalendar::DateKey(day) + ": " : std::string(", "))
+               << (tag == TagTable::NO_TAG ? noTagStr : TagTable::Name(tag)) << " "
+               << minutes / 60 << ":" << std::setfill('0') << std::setw(2) << minutes % 60;
+            first = false;
         }
-        else if (isLeaveEvent && arrived) {
-            auto leaveTime = ParseTimeFromLine(line);
-
-            // Check if time parsing was successful
-            auto epoch = std::chrono::system_clock::time_point{};
-            if (leaveTime != epoch) {
-                auto duration = std::chrono::duration_cast<std::chrono::minutes>(
-                    leaveTime - arriveTime).count();
-
-                // Only count positive durations
-                if (duration > 0) {
-                    std::string key = daily ? GetDateKey(arriveTime) : GetWeekKey(arriveTime);
-                    summary[key] += duration;
-                    processedDepartures++;
-
-                    DebugOutput("Recorded departure at: " + TimeToString(leaveTime) +
-                               ", Duration: " + std::to_string(duration) + " minutes, Key: " + key);
-                }
-                arrived = false;
-            }
+        if (!first) {
+            ss << "\r\n";
         }
     }
+    return ss.str();
+}
 
-    file.close();
+void TimeTracker::SetSummaryWeeks(int weeks) {
+    summaryWeeks = weeks;
+}
 
-    DebugOutput("Summary: Total lines: " + std::to_string(totalLines) +
-               ", Arrivals: " + std::to_string(processedArrivals) +
-               ", Departures: " + std::to_string(processedDepartures) +
-               ", Summary entries: " + std::to_string(summary.size()));
+void TimeTracker::SetArchiveBefore(int day) {
+    archiveBeforeDay = day;
 }
 
-std::chrono::system_clock::time_point TimeTracker::ParseTimeFromLine(const std::string& line) {
-    // Parse format: DD.MM.YYYY,HH:MM:SS,EVENT
-    // Find the second comma to get the datetime part
-    size_t firstComma = line.find(',');
-    size_t secondComma = line.find(',', firstComma + 1);
+void TimeTracker::SetSummaryFilter(const SessionFilter& filter) {
+    summaryFilter = filter;
+}
 
-    if (firstComma == std::string::npos || secondComma == std::string::npos) {
-        DebugOutput("Invalid line format - missing commas: " + line);
-        return std::chrono::system_clock::time_point{}; // Return epoch time on error
+void TimeTracker::SwitchTag(const std::string& tag) {
+    std::string newTag = TagTable::Sanitize(tag);
+    if (newTag == activeTag) {
+        return;
     }
 
-    // Extract the datetime portion: "DD.MM.YYYY,HH:MM:SS"
-    std::string dateTimeStr = line.substr(0, secondComma);
-
-    DebugOutput("Parsing datetime: " + dateTimeStr);
-
-    // Parse the date part (DD.MM.YYYY)
-    std::string datePart = line.substr(0, firstComma);
-    std::string timePart = line.substr(firstComma + 1, secondComma - firstComma - 1);
-
-    DebugOutput("Date part: " + datePart + ", Time part: " + timePart);
-
-    std::tm tm = {};
-
-    // Parse date: DD.MM.YYYY
-    std::istringstream dateStream(datePart);
-    char dot1, dot2;
-    int day, month, year;
-    dateStream >> day >> dot1 >> month >> dot2 >> year;
-
-    if (dateStream.fail() || dot1 != '.' || dot2 != '.') {
-        DebugOutput("Failed to parse date components: " + datePart);
-        return std::chrono::system_clock::time_point{};
+    activeTag = newTag;
+    TagTable::Intern(activeTag);
+    if (isArrived) {
+        WriteEvent(std::chrono::system_clock::now(), filename, LogEventKind::Switch);
+        UpdateRollup();
     }
-
-    // Parse time: HH:MM:SS
-    std::istringstream timeStream(timePart);
-    char colon1, colon2;
-    int hour, minute, second;
-    timeStream >> hour >> colon1 >> minute >> colon2 >> second;
-
-    if (timeStream.fail() || colon1 != ':' || colon2 != ':') {
-        DebugOutput("Failed to parse time components: " + timePart);
-        return std::chrono::system_clock::time_point{};
+    if (hComboTag) {
+        SetWindowTextW(hComboTag, StringToWString(activeTag).c_str());
     }
+    LOG_INFO("Active tag: " + activeTag);
+}
 
-    // Set tm structure
-    tm.tm_mday = day;
-    tm.tm_mon = month - 1;  // months are 0-based
-    tm.tm_year = year - 1900;  // years since 1900
-    tm.tm_hour = hour;
-    tm.tm_min = minute;
-    tm.tm_sec = second;
-    tm.tm_isdst = -1; // Let system determine DST
-
-    auto time_t_val = std::mktime(&tm);
-    if (time_t_val == -1) {
-        DebugOutput("mktime failed for: " + std::to_string(day) + "." + std::to_string(month) + "." +
-                   std::to_string(year) + " " + std::to_string(hour) + ":" +
-                   std::to_string(minute) + ":" + std::to_string(second));
-        return std::chrono::system_clock::time_point{}; // Return epoch time on error
+void TimeTracker::FillTagList() {
+    // Every tag parsed so far, e.g. by the rollup or a summary
+    SendMessageW(hComboTag, CB_RESETCONTENT, 0, 0);
+    int count = TagTable::Count();
+    for (int tag = TagTable::NO_TAG + 1; tag < count; tag++) {
+        std::wstring name = StringToWString(TagTable::Name(tag));
+        SendMessageW(hComboTag, CB_ADDSTRING, 0, (LPARAM)name.c_str());
     }
+    SetWindowTextW(hComboTag, StringToWString(activeTag).c_str());
+}
 
-    DebugOutput("Successfully parsed time: " + std::to_string(day) + "." + std::to_string(month) + "." +
-               std::to_string(year) + " " + std::to_string(hour) + ":" +
-               std::to_string(minute) + ":" + std::to_string(second));
-
-    return std::chrono::system_clock::from_time_t(time_t_val);
+SummaryWindow TimeTracker::GetSummaryWindow() const {
+    return SummaryWindow::LastWeeks(summaryWeeks, std::chrono::system_clock::now());
 }
 
-std::string TimeTracker::GetDateKey(const std::chrono::system_clock::time_point& tp) {
-    std::time_t tt = std::chrono::system_clock::to_time_t(tp);
-    std::tm tm = *std::localtime(&tt);
-    std::stringstream ss;
-    ss << std::setfill('0') << std::setw(2) << tm.tm_mday << "."
-       << std::setfill('0') << std::setw(2) << (tm.tm_mon + 1) << "."
-       << (tm.tm_year + 1900);
-    return ss.str();
+void TimeTracker::SetQueryEndpoint(const std::string& endpoint) {
+    queryEndpoint = endpoint;
 }
 
-std::string TimeTracker::GetWeekKey(const std::chrono::system_clock::time_point& tp) {
-    std::time_t tt = std::chrono::system_clock::to_time_t(tp);
-    std::tm tm = *std::localtime(&tt);
+void QueryCall::Answer(const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex);
+    response = text;
+    answered = true;
+    done.notify_one();
+}
 
-    // Calculate ISO week number more accurately
-    int year = tm.tm_year + 1900;
-    int dayOfYear = tm.tm_yday + 1; // tm_yday is 0-based
-    int dayOfWeek = tm.tm_wday; // 0=Sunday, 1=Monday, etc.
-
-    // Adjust for Monday as first day of week (ISO standard)
-    if (dayOfWeek == 0) dayOfWeek = 7; // Sunday becomes 7
-
-    // Calculate week number
-    int weekNumber = (dayOfYear - dayOfWeek + 10) / 7;
-
-    // Adjust for weeks that span year boundaries
-    if (weekNumber == 0) {
-        year--;
-        weekNumber = 52; // or 53, but 52 is simpler
-    } else if (weekNumber > 52) {
-        // Check if we're actually in week 1 of next year
-        year++;
-        weekNumber = 1;
+bool QueryCall::Wait(int timeoutMs, std::string& text) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!done.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return answered; })) {
+        return false;
     }
+    text = response;
+    return true;
+}
 
-    std::stringstream ss;
-    ss << year << "-W" << std::setfill('0') << std::setw(2) << weekNumber;
-    return ss.str();
+std::string TimeTracker::HandleQuery(const std::string& request) {
+    TrackerState state;
+    state.now = std::chrono::system_clock::now();
+    state.present = isArrived;
+    state.arriveTime = arriveTime;
+    // While away, all of today's sessions are closed and in the rollup
+    state.minutesToday = isArrived ? (int)MinutesToday(state.now)
+                                   : rollup.Minutes(IsoCalendar::LocalDayNumber(state.now));
+    state.tag = activeTag;
+    return AnswerQuery(request, state, rollup);
+}
+
+void TimeTracker::UpdateRollup() {
+    // Parses only what was appended since the last update
+    rollup.CatchUp(filename, filenameArchive);
+    rollup.Save(filenameRollup);
 }
 
 void TimeTracker::OpenLog() {
@@ -473,8 +663,16 @@ void TimeTracker::OpenLog() {
 }
 
 void TimeTracker::ShowAbout() {
+    std::wstring text = localization->Get("ABOUT_TEXT");
+
+    // Instrumented builds show the current metrics on demand here
+    if (Metrics::IsEnabled()) {
+        std::string metrics = Metrics::DumpText();
+        text += L"\n\n" + std::wstring(metrics.begin(), metrics.end());
+    }
+
     MessageBoxW(hWnd,
-        localization->Get("ABOUT_TEXT").c_str(),
+        text.c_str(),
         localization->Get("ABOUT_TITLE").c_str(),
         MB_OK | MB_ICONINFORMATION);
 }
@@ -485,9 +683,20 @@ void TimeTracker::Close() {
 }
 
 void TimeTracker::OnDestroy() {
-    WriteEvent(std::chrono::system_clock::now(), filename, localization->GetLogEvent("LOG_LEAVE_CLOSED"));
+    queryServer.Stop();
+    // Closed during startup: the ARRIVE must be written before the LEAVE
+    if (startupTask.joinable()) {
+        startupTask.join();
+    }
+    WriteEvent(std::chrono::system_clock::now(), filename, LogEventKind::LeaveClosed);
+    UpdateRollup();
     KillTimer(hWnd, ID_TIMER);
     DeleteFileW(std::wstring(filenameTmp.begin(), filenameTmp.end()).c_str());
+
+    if (Metrics::IsEnabled()) {
+        LOG_INFO("Metrics at exit:\n" + Metrics::DumpText());
+    }
+    Logger::Flush();
 }
 
 void TimeTracker::HandleCommand(WPARAM wParam) {
@@ -504,6 +713,9 @@ void TimeTracker::HandleCommand(WPARAM wParam) {
         case ID_BTN_WEEKLY:
             ShowWeeklySummary();
             break;
+        case ID_BTN_TAGS:
+            ShowTagSummary();
+            break;
         case ID_BTN_OPENLOG:
             OpenLog();
             break;
@@ -513,27 +725,29 @@ void TimeTracker::HandleCommand(WPARAM wParam) {
         case ID_BTN_CLOSE:
             Close();
             break;
+        case ID_BTN_SWITCH_TAG: {
+            wchar_t text[256] = {};
+            GetWindowTextW(hComboTag, text, 256);
+            SwitchTag(WStringToString(text));
+            break;
+        }
+        case ID_CMB_TAG:
+            if (HIWORD(wParam) == CBN_DROPDOWN) {
+                FillTagList();
+            }
+            break;
     }
 }
 
 void TimeTracker::WriteEvent(const std::chrono::system_clock::time_point& t,
-               const std::string& fname, const std::string& s, bool append) {
-    std::ofstream ofs(fname, append ? std::ios::app : std::ios::out);
-    ofs << TimeToString(t) << "," << s << std::endl;
-    ofs.close();
-}
-
-std::string TimeTracker::TimeToString(const std::chrono::system_clock::time_point& t) {
-    std::time_t tt = std::chrono::system_clock::to_time_t(t);
-    std::tm tm = *std::localtime(&tt);
-    std::stringstream ss;
-    ss << std::setfill('0') << std::setw(2) << tm.tm_mday << "."
-       << std::setfill('0') << std::setw(2) << (tm.tm_mon + 1) << "."
-       << (tm.tm_year + 1900) << ","
-       << std::setfill('0') << std::setw(2) << tm.tm_hour << ":"
-       << std::setfill('0') << std::setw(2) << tm.tm_min << ":"
-       << std::setfill('0') << std::setw(2) << tm.tm_sec;
-    return ss.str();
+               const std::string& fname, LogEventKind kind, bool append) {
+    LogRecord record;
+    record.time = t;
+    record.day = IsoCalendar::LocalDayNumber(t);
+    record.kind = kind;
+    record.tag = LogParser::IsArrive(kind) || kind == LogEventKind::Switch ? TagTable::Intern(activeTag)
+                                                                           : TagTable::NO_TAG;
+    LogWriter::WriteRecord(fname, record, append);
 }
 
 std::wstring TimeTracker::TimeToWString(const std::chrono::system_clock::time_point& t) {
@@ -5,7 +5,18 @@
 #include <string>
 #include <chrono>
 #include <map>
+#include <tuple>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include "localization.h"
+#include "SummaryStream.h"
+#include "DayRollup.h"
+#include "LogQuery.h"
+#include "QueryServer.h"
+#include "WorkCalendar.h"
+#include "StartupTask.h"
 
 // Control IDs
 #define ID_TIMER 1
@@ -16,11 +27,40 @@
 #define ID_BTN_OPENLOG 1005
 #define ID_BTN_ABOUT 1006
 #define ID_BTN_CLOSE 1007
+#define ID_CMB_TAG 1008
+#define ID_BTN_SWITCH_TAG 1009
+#define ID_BTN_TAGS 1010
+
+// Query posted by the query server thread: lParam = new std::shared_ptr<QueryCall>,
+// deleted by the UI thread
+#define WM_APP_QUERY (WM_APP + 1)
+// Posted by the startup task when the log I/O of the launch is done
+#define WM_APP_STARTED (WM_APP + 2)
 
 // Timer interval (60 seconds)
 #define TIMER_INTERVAL 60000
 #define HIBERNATION_THRESHOLD 120 // 2 minutes in seconds
 
+// One query handed from the query server thread to the UI thread. Both hold
+// a reference, so a server that gave up waiting leaves nothing dangling.
+class QueryCall {
+public:
+    explicit QueryCall(const std::string& request) : request(request), answered(false) {}
+
+    const std::string& Request() const { return request; }
+    // UI thread
+    void Answer(const std::string& text);
+    // Server thread; false if no answer came within timeoutMs
+    bool Wait(int timeoutMs, std::string& text);
+
+private:
+    const std::string request;
+    std::string response;
+    bool answered;
+    std::mutex mutex;
+    std::condition_variable done;
+};
+
 class TimeTracker {
 private:
     HWND hWnd;
@@ -31,19 +71,39 @@ private:
     HWND hBtnLeave;
     HWND hBtnDaily;
     HWND hBtnWeekly;
+    HWND hBtnTags;
     HWND hBtnOpenLog;
     HWND hBtnAbout;
     HWND hBtnClose;
+    HWND hComboTag;
+    HWND hBtnSwitchTag;
 
     std::chrono::system_clock::time_point arriveTime;
     std::chrono::system_clock::time_point lastActiveTime;
     uint32_t minutesHibernation;
+    uint32_t minutesEarlierToday;  // closed sessions of today before arriveTime
     bool isArrived;
+    std::string activeTag;  // project tag written with ARRIVE, empty = none
 
     const std::string filename = "Timelog.txt";
     const std::string filenameTmp = "Timelog_tmp.txt";
+    const std::string filenameRollup = "Timelog_rollup.dat";
+    const std::string filenameArchive = "Timelog_archive.dat";
+    const std::string filenameCalendar = "Timelog_calendar.txt";
+
+    DayRollup rollup;
+    WorkCalendar calendar;  // target hours, unconfigured without a calendar file
+    QueryServer queryServer;
+    std::thread startupTask;
+    StartupResult startupResult;  // written by startupTask until WM_APP_STARTED
+    bool startupDone;
+    std::map<std::tuple<int, bool, std::wstring>, HFONT> fonts;  // shared by all controls
+    std::string queryEndpoint;  // empty = no query endpoint
 
     int summaryFontSize = 14;  // Default font size
+    int summaryWeeks = 0;      // Weeks shown in summaries, 0 = whole log
+    int archiveBeforeDay = 0;  // Archive days before this day number at startup, 0 = off
+    SessionFilter summaryFilter;  // Sessions and hours the summaries count
 
     Localization* localization;
 
@@ -54,28 +114,34 @@ private:
                             int controlId, DWORD style = WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON);
     void SetControlFont(HWND hControl, int fontSize = 16, bool bold = false,
                        const wchar_t* fontName = L"Arial");
+    HFONT GetFont(int fontSize, bool bold, const wchar_t* fontName);
 
     // Internal helper functions
+    // ARRIVE and SWITCH events carry the active tag
     void WriteEvent(const std::chrono::system_clock::time_point& t,
-                   const std::string& fname, const std::string& s, bool append = true);
-    std::string TimeToString(const std::chrono::system_clock::time_point& t);
+                   const std::string& fname, LogEventKind kind, bool append = true);
     std::wstring TimeToWString(const std::chrono::system_clock::time_point& t);
     std::string WStringToString(const std::wstring& wstr) const;
+    std::wstring StringToWString(const std::string& str) const;  // from UTF-8
+    void FillTagList();
+    // Shows the arrival and switches the buttons to the present state
+    void ShowArrived();
+
+    // Minutes worked today while present, as shown in the main window
+    uint64_t MinutesToday(const std::chrono::system_clock::time_point& now) const;
 
-    // Log parsing functions
-    std::chrono::system_clock::time_point ParseTimeFromLine(const std::string& line);
-    std::string GetDateKey(const std::chrono::system_clock::time_point& tp);
-    std::string GetWeekKey(const std::chrono::system_clock::time_point& tp);
-    void ParseLogFile(std::map<std::string, int>& summary, bool daily);
+    SummaryWindow GetSummaryWindow() const;
+    void UpdateRollup();
     void SetButtonFont(HWND hButton);
 public:
     TimeTracker(Localization* loc);
-    ~TimeTracker() = default;
+    ~TimeTracker();
 
     // Main interface functions
     void Initialize(HWND hwnd);
     void CreateControls();
-    void CheckCrashRecovery();
+    // Finishes Initialize on the UI thread once the startup task is done
+    void OnStartupComplete();
     void OnTimer();
     void HandleCommand(WPARAM wParam);
     void OnDestroy();
@@ -85,14 +151,30 @@ public:
     void Leave();
     void ShowDailySummary();
     void ShowWeeklySummary();
+    void ShowTagSummary();
     void OpenLog();
     void ShowAbout();
     void Close();
 
     // Summary generation functions
-    std::string GenerateDailySummary();
-    std::string GenerateWeeklySummary();
+    std::string GenerateTagSummary();
+    void RegisterSummaryDialogClass();
     void ShowSummaryDialog(bool daily);
+    void SetSummaryWeeks(int weeks);
+    void SetArchiveBefore(int day);
+    void SetSummaryFilter(const SessionFilter& filter);
+    void SetQueryEndpoint(const std::string& endpoint);
+
+    // Answers a query endpoint request; runs on the UI thread
+    std::string HandleQuery(const std::string& request);
+
+    // Books the following time on tag; closes the running session if the
+    // tag changes while present
+    void SwitchTag(const std::string& tag);
+    const std::string& GetActiveTag() const { return activeTag; }
+
+    // Per-day totals for date-range queries, kept current as sessions close
+    const DayRollup& GetRollup() const { return rollup; }
 };
 
 #endif // TIMETRACKER_H
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "WorkCalendar.h"
+#include "IsoCalendar.h"
+#include "LogQuery.h"
+#include "Logger.h"
+#include <fstream>
+#include <bitset>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+static int Popcount(uint64_t bits) {
+    return (int)std::bitset<64>(bits).count();
+}
+
+// "YYYY-MM-DD" or "YYYY-MM-DD..YYYY-MM-DD"
+static bool ParseDayRange(const std::string& text, int& fromDay, int& toDay) {
+    int used;
+    if (!IsoCalendar::ParseIsoDate(text.c_str(), fromDay, used)) {
+        return false;
+    }
+    toDay = fromDay;
+    if (text.compare(used, 2, "..") == 0) {
+        int usedTo;
+        if (!IsoCalendar::ParseIsoDate(text.c_str() + used + 2, toDay, usedTo)) {
+            return false;
+        }
+        used += 2 + usedTo;
+    }
+    return used == (int)text.size() && fromDay <= toDay;
+}
+
+// "[+|-]H:MM" as minutes
+static bool ParseMinutes(const std::string& text, int64_t& minutes) {
+    bool negative = !text.empty() && text[0] == '-';
+    size_t start = !text.empty() && (text[0] == '-' || text[0] == '+') ? 1 : 0;
+    int hours, mins, used = 0;
+    if (std::sscanf(text.c_str() + start, "%d:%d%n", &hours, &mins, &used) != 2 ||
+        start + used != text.size() || hours < 0 || mins < 0 || mins > 59) {
+        return false;
+    }
+    minutes = (int64_t)hours * 60 + mins;
+    if (negative) {
+        minutes = -minutes;
+    }
+    return true;
+}
+
+WorkCalendar::WorkCalendar()
+    : targetMinutes(8 * 60), startDay(NO_DAY), carryMinutes(0), configured(false) {
+    SetWorkdays(0x1F);  // Monday to Friday
+}
+
+void WorkCalendar::SetWorkdays(unsigned weekdayMask) {
+    workdays = weekdayMask & 0x7F;
+    for (int first = 0; first < 7; first++) {
+        patterns[first] = 0;
+        for (int i = 0; i < 64; i++) {
+            if (workdays & (1u << ((first + i) % 7))) {
+                patterns[first] |= 1ULL << i;
+            }
+        }
+    }
+}
+
+bool WorkCalendar::ParseLine(const std::string& line) {
+    size_t equals = line.find('=');
+    if (equals == std::string::npos) {
+        return false;
+    }
+    std::string key = line.substr(0, equals);
+    std::string value = line.substr(equals + 1);
+
+    if (key == "workdays") {
+        // Same syntax as the --weekdays filter
+        SessionFilter weekdays;
+        if (!weekdays.ParseOption("--weekdays=" + value)) {
+            return false;
+        }
+        SetWorkdays(weekdays.weekdays);
+        return true;
+    }
+    if (key == "target") {
+        int64_t minutes;
+        if (!ParseMinutes(value, minutes) || minutes < 0 || minutes > 24 * 60) {
+            return false;
+        }
+        targetMinutes = (int)minutes;
+        return true;
+    }
+    if (key == "carry") {
+        return ParseMinutes(value, carryMinutes);
+    }
+
+    int fromDay, toDay;
+    if (!ParseDayRange(value, fromDay, toDay)) {
+        return false;
+    }
+    if (key == "start" && fromDay == toDay) {
+        startDay = fromDay;
+    } else if (key == "holiday") {
+        AddHoliday(fromDay, toDay);
+    } else if (key == "absence") {
+        AddAbsence(fromDay, toDay);
+    } else if (key == "workday") {
+        AddWorkday(fromDay, toDay);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool WorkCalendar::Load(const std::string& fname) {
+    std::ifstream file(fname);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    WorkCalendar loaded;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (!loaded.ParseLine(line)) {
+            LOG_ERROR("Invalid line " + std::to_string(lineNumber) + " in " + fname + ": " + line);
+            return false;
+        }
+    }
+
+    *this = loaded;
+    configured = true;
+    return true;
+}
+
+void WorkCalendar::SetDays(int fromDay, int toDay, DayKind kind) {
+    for (int day = fromDay; day <= toDay; day++) {
+        int year = IsoCalendar::CivilFromDays(day).year;
+        int index = day - IsoCalendar::DaysFromCivil(year, 1, 1);
+        auto it = years.find(year);
+        if (it == years.end()) {
+            it = years.emplace(year, YearBits()).first;
+            std::memset(&it->second, 0, sizeof(YearBits));
+        }
+        it->second.sets[kind][index / 64] |= 1ULL << (index % 64);
+    }
+}
+
+void WorkCalendar::AddHoliday(int fromDay, int toDay) {
+    SetDays(fromDay, toDay, HOLIDAY);
+}
+
+void WorkCalendar::AddAbsence(int fromDay, int toDay) {
+    SetDays(fromDay, toDay, ABSENCE);
+}
+
+void WorkCalendar::AddWorkday(int fromDay, int toDay) {
+    SetDays(fromDay, toDay, EXTRA_WORKDAY);
+}
+
+uint64_t WorkCalendar::WorkdayWord(const YearBits* bits, int word, int wordStart) const {
+    uint64_t result = patterns[IsoCalendar::Weekday(wordStart) - 1];
+    if (bits) {
+        result |= bits->sets[EXTRA_WORKDAY][word];
+        result &= ~(bits->sets[HOLIDAY][word] | bits->sets[ABSENCE][word]);
+    }
+    return result;
+}
+
+bool WorkCalendar::IsWorkday(int day) const {
+    return TargetDays(day, day) == 1;
+}
+
+int WorkCalendar::TargetDays(int fromDay, int toDay) const {
+    int count = 0;
+    // One year at a time; a year spans at most six words
+    for (int day = fromDay; day <= toDay; ) {
+        int year = IsoCalendar::CivilFromDays(day).year;
+        int jan1 = IsoCalendar::DaysFromCivil(year, 1, 1);
+        int last = std::min(toDay, IsoCalendar::DaysFromCivil(year + 1, 1, 1) - 1);
+        int lo = day - jan1;
+        int hi = last - jan1;
+
+        auto it = years.find(year);
+        const YearBits* bits = it == years.end() ? nullptr : &it->second;
+        for (int word = lo / 64; word <= hi / 64; word++) {
+            uint64_t mask = ~0ULL;
+            if (word == lo / 64) {
+                mask &= ~0ULL << (lo % 64);
+            }
+            if (word == hi / 64) {
+                mask &= ~0ULL >> (63 - hi % 64);
+            }
+            count += Popcount(WorkdayWord(bits, word, jan1 + word * 64) & mask);
+        }
+        day = last + 1;
+    }
+    return count;
+}
+
+int64_t WorkCalendar::TargetMinutes(int fromDay, int toDay) const {
+    return (int64_t)TargetDays(fromDay, toDay) * targetMinutes;
+}
+
+bool WorkCalendar::FlexBalance(const DayRollup& rollup, int toDay, int64_t& balance) const {
+    int firstDay = startDay != NO_DAY ? startDay : (rollup.IsEmpty() ? NO_DAY : rollup.FirstDay());
+    if (firstDay == NO_DAY || toDay < firstDay) {
+        return false;
+    }
+    balance = carryMinutes + rollup.Sum(firstDay, toDay) - TargetMinutes(firstDay, toDay);
+    return true;
+}
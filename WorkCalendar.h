@@ -0,0 +1,80 @@
+#ifndef WORKCALENDAR_H
+#define WORKCALENDAR_H
+
+#include <string>
+#include <map>
+#include <cstdint>
+#include <climits>
+#include "DayRollup.h"
+
+// Workdays, holidays and absences, and the target hours they imply.
+//
+// Every configured year keeps three bitsets with one bit per day of the
+// year: extra workdays (e.g. a working Saturday), holidays and absences.
+// The regular workdays come from a weekday mask, expanded to 64-day words by
+// one of seven precomputed patterns. Counting target days over a range is a
+// popcount per word, so a year costs six word operations.
+//
+// The calendar is read from a text file with one "key=value" per line:
+//   workdays=1-5                   weekdays with a target (1 = Monday)
+//   target=08:00                   target time per workday
+//   start=2024-01-01               first day of the flex-time account
+//   carry=+12:30                   balance brought into the account
+//   holiday=2024-12-25             single days or ranges
+//   absence=2024-08-05..2024-08-16 vacation, sick leave, ...
+//   workday=2024-12-21             extra workday outside the weekday mask
+// Empty lines and lines starting with '#' are ignored.
+class WorkCalendar {
+public:
+    static const int WORDS_PER_YEAR = 6;  // 366 bits
+    static const int NO_DAY = INT_MIN;
+
+    WorkCalendar();
+
+    // Returns false if the file is missing or has an invalid line; the
+    // calendar is then left unconfigured
+    bool Load(const std::string& fname);
+    bool IsConfigured() const { return configured; }
+
+    // Applies one "key=value" line. Returns false if it is not valid.
+    bool ParseLine(const std::string& line);
+
+    void SetWorkdays(unsigned weekdayMask);
+    void SetTargetMinutes(int minutesPerWorkday) { targetMinutes = minutesPerWorkday; }
+    void AddHoliday(int fromDay, int toDay);
+    void AddAbsence(int fromDay, int toDay);
+    void AddWorkday(int fromDay, int toDay);
+
+    bool IsWorkday(int day) const;
+    // Inclusive day ranges
+    int TargetDays(int fromDay, int toDay) const;
+    int64_t TargetMinutes(int fromDay, int toDay) const;
+
+    // Running flex-time at the end of toDay: the carried balance plus worked
+    // minus target minutes since the start of the account. The account starts
+    // with the first day of the rollup unless a start day is configured.
+    // Returns false if toDay lies before the account starts.
+    bool FlexBalance(const DayRollup& rollup, int toDay, int64_t& balance) const;
+
+private:
+    enum DayKind { EXTRA_WORKDAY, HOLIDAY, ABSENCE, DAY_KINDS };
+
+    // Bit i of a set stands for January 1st + i
+    struct YearBits {
+        uint64_t sets[DAY_KINDS][WORDS_PER_YEAR];
+    };
+
+    void SetDays(int fromDay, int toDay, DayKind kind);
+    // Workday bits of the 64 days starting at wordStart
+    uint64_t WorkdayWord(const YearBits* bits, int word, int wordStart) const;
+
+    unsigned workdays;        // bit Weekday(day) - 1
+    uint64_t patterns[7];     // workday bits of 64 days starting on weekday index + 1
+    int targetMinutes;
+    int startDay;             // NO_DAY = first day of the rollup
+    int64_t carryMinutes;
+    std::map<int, YearBits> years;
+    bool configured;
+};
+
+#endif // WORKCALENDAR_H
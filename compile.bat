@@ -23,9 +23,9 @@ echo.
 
 :: Attempt compilation
 echo Step 3: Compiling with Visual Studio...
-echo Command: cl /EHsc /utf-8 /O2 *.cpp /Fe:TimeRecording.exe /link user32.lib gdi32.lib comctl32.lib shell32.lib
+echo Command: cl /EHsc /utf-8 /O2 *.cpp /Fe:TimeRecording.exe /link user32.lib gdi32.lib comctl32.lib shell32.lib advapi32.lib
 echo.
-cl /EHsc /utf-8 /O2 *.cpp /Fe:TimeRecording.exe /link user32.lib gdi32.lib comctl32.lib shell32.lib
+cl /EHsc /utf-8 /O2 *.cpp /Fe:TimeRecording.exe /link user32.lib gdi32.lib comctl32.lib shell32.lib advapi32.lib
 
 set COMPILE_RESULT=%ERRORLEVEL%
 echo.
@@ -4,8 +4,6 @@
 #include <string>
 #include <map>
 #include <vector>
-#include <codecvt>
-#include <locale>
 
 #pragma execution_character_set("utf-8")
 
@@ -34,6 +32,9 @@ private:
         translations["BTN_WEEKLY_SUMMARY"]["de"] = L"W\u00F6chentliche Zusammenfassung";
         translations["BTN_WEEKLY_SUMMARY"]["en"] = L"Weekly Summary";
 
+        translations["BTN_TAG_SUMMARY"]["de"] = L"Zeit pro Projekt";
+        translations["BTN_TAG_SUMMARY"]["en"] = L"Time per Project";
+
         translations["BTN_OPEN_LOG"]["de"] = L"Log \u00F6ffnen";
         translations["BTN_OPEN_LOG"]["en"] = L"Open Log";
 
@@ -43,6 +44,9 @@ private:
         translations["BTN_CLOSE"]["de"] = L"Schlie\u00DFen";
         translations["BTN_CLOSE"]["en"] = L"Close";
 
+        translations["BTN_SWITCH_TAG"]["de"] = L"Wechseln";
+        translations["BTN_SWITCH_TAG"]["en"] = L"Switch";
+
         // Dialog titles
         translations["DAILY_SUMMARY_TITLE"]["de"] = L"T\u00E4gliche Zusammenfassung";
         translations["DAILY_SUMMARY_TITLE"]["en"] = L"Daily Summary";
@@ -50,6 +54,9 @@ private:
         translations["WEEKLY_SUMMARY_TITLE"]["de"] = L"W\u00F6chentliche Zusammenfassung";
         translations["WEEKLY_SUMMARY_TITLE"]["en"] = L"Weekly Summary";
 
+        translations["TAG_SUMMARY_TITLE"]["de"] = L"Zeit pro Projekt";
+        translations["TAG_SUMMARY_TITLE"]["en"] = L"Time per Project";
+
         translations["ABOUT_TITLE"]["de"] = L"Info";
         translations["ABOUT_TITLE"]["en"] = L"About";
 
@@ -69,31 +76,36 @@ private:
         translations["WEEKLY_SUMMARY_HEADER"]["de"] = L"=== WOECHENTLICHE ZUSAMMENFASSUNG ===";
         translations["WEEKLY_SUMMARY_HEADER"]["en"] = L"=== WEEKLY SUMMARY ===";
 
-        // Time units
-        translations["HOURS"]["de"] = L"Stunden";
-        translations["HOURS"]["en"] = L"hours";
+        translations["TAG_SUMMARY_HEADER"]["de"] = L"=== ZEIT PRO PROJEKT ===";
+        translations["TAG_SUMMARY_HEADER"]["en"] = L"=== TIME PER PROJECT ===";
 
-        translations["WEEK"]["de"] = L"Woche";
-        translations["WEEK"]["en"] = L"Week";
+        translations["NO_TAG"]["de"] = L"(ohne Projekt)";
+        translations["NO_TAG"]["en"] = L"(no project)";
+
+        // Summary list columns
+        translations["SUMMARY_COLUMN_DAY"]["de"] = L"Tag";
+        translations["SUMMARY_COLUMN_DAY"]["en"] = L"Day";
+
+        translations["SUMMARY_COLUMN_TIME"]["de"] = L"Zeit";
+        translations["SUMMARY_COLUMN_TIME"]["en"] = L"Time";
 
-        // Log event messages (these should remain consistent for log parsing)
-        translations["LOG_ARRIVE"]["de"] = L"ARRIVE";
-        translations["LOG_ARRIVE"]["en"] = L"ARRIVE";
+        translations["SUMMARY_COLUMN_TARGET"]["de"] = L"Soll";
+        translations["SUMMARY_COLUMN_TARGET"]["en"] = L"Target";
 
-        translations["LOG_LEAVE"]["de"] = L"LEAVE";
-        translations["LOG_LEAVE"]["en"] = L"LEAVE";
+        translations["SUMMARY_COLUMN_BALANCE"]["de"] = L"Saldo";
+        translations["SUMMARY_COLUMN_BALANCE"]["en"] = L"Balance";
 
-        translations["LOG_LEAVE_HIBERNATION"]["de"] = L"LEAVE (app hibernation)";
-        translations["LOG_LEAVE_HIBERNATION"]["en"] = L"LEAVE (app hibernation)";
+        translations["SUMMARY_COLUMN_FLEX"]["de"] = L"Gleitzeit";
+        translations["SUMMARY_COLUMN_FLEX"]["en"] = L"Flex time";
 
-        translations["LOG_ARRIVE_HIBERNATION"]["de"] = L"ARRIVE (from hibernation)";
-        translations["LOG_ARRIVE_HIBERNATION"]["en"] = L"ARRIVE (from hibernation)";
+        // Time units
+        translations["HOURS"]["de"] = L"Stunden";
+        translations["HOURS"]["en"] = L"hours";
 
-        translations["LOG_LEAVE_CLOSED"]["de"] = L"LEAVE (app closed)";
-        translations["LOG_LEAVE_CLOSED"]["en"] = L"LEAVE (app closed)";
+        translations["WEEK"]["de"] = L"Woche";
+        translations["WEEK"]["en"] = L"Week";
 
-        translations["LOG_LEAVE_TERMINATED"]["de"] = L"LEAVE (app forcefully terminated)";
-        translations["LOG_LEAVE_TERMINATED"]["en"] = L"LEAVE (app forcefully terminated)";
+        // Log event texts are not translated; see LogParser::EventText
 
         // Default time display
         translations["DEFAULT_TIME"]["de"] = L"0:00";
@@ -117,25 +129,6 @@ private:
         translations["STATUS_STOPPED"]["en"] = L"Time tracking stopped";
     }
 
-    // Helper function to convert wstring to string safely
-    std::string WStringToString(const std::wstring& wstr) const {
-        if (wstr.empty()) {
-            return std::string();
-        }
-
-        // Use Windows API for conversion on Windows platform
-        #ifdef _WIN32
-        int size_needed = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
-        std::string strTo(size_needed, 0);
-        WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], size_needed, NULL, NULL);
-        return strTo;
-        #else
-        // Fallback for non-Windows platforms
-        std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> converter;
-        return converter.to_bytes(wstr);
-        #endif
-    }
-
 public:
     // Constructor accepts language code
     Localization(const std::string& lang = "de") : language(lang) {
@@ -164,11 +157,6 @@ public:
         return std::wstring(key.begin(), key.end());
     }
 
-    // Get translated string for log events (returns std::string for file writing)
-    std::string GetLogEvent(const std::string& key) const {
-        std::wstring wstr = Get(key);
-        return WStringToString(wstr);
-    }
 
     // Get current language
     std::string GetLanguage() const {
@@ -10,23 +10,37 @@
 #include <shellapi.h>
 #include <iostream>
 #include <string>
+#include <cwchar>
+#include <memory>
 #include "localization.h"
 #include "TimeTracker.h"
+#include "Logger.h"
+#include "IsoCalendar.h"
 
 #pragma comment(lib, "comctl32.lib")
 #pragma comment(lib, "shell32.lib")
 
 // Window dimensions
 #define WINDOW_WIDTH 300
-#define WINDOW_HEIGHT 500
+#define WINDOW_HEIGHT 580
 
 TimeTracker* g_pTracker = nullptr;
 Localization* g_pLocalization = nullptr;
+int g_summaryWeeks = 0;
+int g_archiveBeforeDay = 0;
+SessionFilter g_summaryFilter;
+std::string g_activeTag;
+std::string g_queryEndpoint;
 
 LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     switch (uMsg) {
         case WM_CREATE:
             g_pTracker = new TimeTracker(g_pLocalization);
+            g_pTracker->SetSummaryWeeks(g_summaryWeeks);
+            g_pTracker->SetArchiveBefore(g_archiveBeforeDay);
+            g_pTracker->SetSummaryFilter(g_summaryFilter);
+            g_pTracker->SwitchTag(g_activeTag);
+            g_pTracker->SetQueryEndpoint(g_queryEndpoint);
             g_pTracker->Initialize(hWnd);
             break;
 
@@ -42,6 +56,21 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             }
             break;
 
+        case WM_APP_STARTED:
+            if (g_pTracker) {
+                g_pTracker->OnStartupComplete();
+            }
+            break;
+
+        case WM_APP_QUERY: {
+            // Posted by the query server thread, answered on the UI thread
+            std::unique_ptr<std::shared_ptr<QueryCall>> call((std::shared_ptr<QueryCall>*)lParam);
+            if (g_pTracker) {
+                (*call)->Answer(g_pTracker->HandleQuery((*call)->Request()));
+            }
+            break;
+        }
+
         case WM_DESTROY:
             if (g_pTracker) {
                 g_pTracker->OnDestroy();
@@ -111,11 +140,134 @@ std::string ParseLanguageFromCommandLine(int argc, wchar_t* argv[]) {
    return language;
 }
 
+void ApplyLogLevelFromCommandLine(int argc, wchar_t* argv[]) {
+   for (int i = 1; i < argc; i++) {
+       std::wstring arg(argv[i]);
+
+       // Format: --log-level=off|error|warning|info|debug|trace
+       if (arg.find(L"--log-level=") == 0) {
+           std::wstring levelW = arg.substr(12);
+           std::string levelStr(levelW.begin(), levelW.end());
+           LogLevel level;
+           if (Logger::ParseLevel(levelStr, level)) {
+               Logger::SetLevel(level);
+           }
+       }
+   }
+}
+
+int ParseSummaryWeeksFromCommandLine(int argc, wchar_t* argv[]) {
+   int weeks = 0; // Default: whole log
+
+   for (int i = 1; i < argc; i++) {
+       std::wstring arg(argv[i]);
+
+       // Format: --summary-weeks=N
+       if (arg.find(L"--summary-weeks=") == 0) {
+           weeks = _wtoi(arg.c_str() + 16);
+           if (weeks < 0) {
+               weeks = 0;
+           }
+       }
+   }
+
+   return weeks;
+}
+
+// Command line values as UTF-8, the encoding of tags in the log
+std::string WideToUtf8(const std::wstring& wstr) {
+   if (wstr.empty()) {
+       return std::string();
+   }
+
+   int size_needed = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
+   std::string str(size_needed, 0);
+   WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &str[0], size_needed, NULL, NULL);
+   return str;
+}
+
+int ParseArchiveBeforeFromCommandLine(int argc, wchar_t* argv[]) {
+   int day = 0; // Default: keep the whole log as text
+
+   for (int i = 1; i < argc; i++) {
+       std::wstring arg(argv[i]);
+
+       // Format: --archive-before=YYYY-MM-DD
+       if (arg.find(L"--archive-before=") == 0) {
+           int parsed;
+           if (IsoCalendar::ParseIsoDate(WideToUtf8(arg.substr(17)), parsed)) {
+               day = parsed;
+           }
+       }
+   }
+
+   return day;
+}
+
+SessionFilter ParseSummaryFilterFromCommandLine(int argc, wchar_t* argv[]) {
+   SessionFilter filter; // Default: count every session
+
+   for (int i = 1; i < argc; i++) {
+       std::wstring arg(argv[i]);
+       std::string argStr(arg.begin(), arg.end());
+
+       // Formats: see SessionFilter::ParseOption; other options are ignored
+       SessionFilter parsed = filter;
+       if (parsed.ParseOption(argStr)) {
+           filter = parsed;
+       }
+   }
+
+   return filter;
+}
+
+std::string ParseTagFromCommandLine(int argc, wchar_t* argv[]) {
+   std::string tag; // Default: continue with the tag of the day
+
+   for (int i = 1; i < argc; i++) {
+       std::wstring arg(argv[i]);
+
+       // Format: --tag=NAME
+       if (arg.find(L"--tag=") == 0) {
+           tag = WideToUtf8(arg.substr(6));
+       }
+   }
+
+   return tag;
+}
+
+std::string ParseQueryEndpointFromCommandLine(int argc, wchar_t* argv[]) {
+   std::string endpoint; // Default: no query endpoint
+
+   for (int i = 1; i < argc; i++) {
+       std::wstring arg(argv[i]);
+
+       // Formats: --query-server or --query-server=\\.\pipe\NAME
+       if (arg == L"--query-server") {
+           endpoint = QueryServer::DefaultEndpoint();
+           if (endpoint.empty()) {
+               LOG_WARNING("No default query endpoint for this user");
+           }
+       } else if (arg.find(L"--query-server=") == 0) {
+           std::wstring endpointW = arg.substr(15);
+           endpoint = std::string(endpointW.begin(), endpointW.end());
+       }
+   }
+
+   return endpoint;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
     // Parse command line for language
     int argc;
     wchar_t** argv = CommandLineToArgvW(GetCommandLineW(), &argc);
     std::string language = ParseLanguageFromCommandLine(argc, argv);
+    ApplyLogLevelFromCommandLine(argc, argv);
+    g_summaryWeeks = ParseSummaryWeeksFromCommandLine(argc, argv);
+    g_archiveBeforeDay = ParseArchiveBeforeFromCommandLine(argc, argv);
+    g_summaryFilter = ParseSummaryFilterFromCommandLine(argc, argv);
+    g_activeTag = ParseTagFromCommandLine(argc, argv);
+    g_queryEndpoint = ParseQueryEndpointFromCommandLine(argc, argv);
     LocalFree(argv);
 
     // Initialize localization
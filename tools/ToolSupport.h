@@ -0,0 +1,34 @@
+#ifndef TOOLSUPPORT_H
+#define TOOLSUPPORT_H
+
+// Log fixtures and statistics shared by the programs in tools/
+
+#include "LogParser.h"
+#include "LogWriter.h"
+#include "Tags.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// One log line with its terminator, as TimeRecording writes it
+inline std::string Line(std::chrono::system_clock::time_point time, LogEventKind kind, int tag = TagTable::NO_TAG) {
+    LogRecord record;
+    record.time = time;
+    record.day = 0;
+    record.kind = kind;
+    record.tag = tag;
+    return LogParser::FormatRecord(record) + LOG_LINE_END;
+}
+
+// The same with the tag given by name, empty for none
+inline std::string Line(std::chrono::system_clock::time_point time, LogEventKind kind, const std::string& tag) {
+    return Line(time, kind, tag.empty() ? TagTable::NO_TAG : TagTable::Intern(tag));
+}
+
+inline double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+#endif // TOOLSUPPORT_H
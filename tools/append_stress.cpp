@@ -0,0 +1,204 @@
+// Stress test of concurrent log appends from several processes.
+//
+// Usage: append_stress [--writers=N] [--records=N] [--dir=PATH]
+// Starts N writer processes (default 8) that each append N records (default
+// 2000) to PATH/Timelog.txt (default "append_stress") through
+// LogWriter::AppendRecord, as several TimeRecording instances would. Every
+// record carries its writer as the tag and its sequence number as the time.
+// Afterwards every line must parse, and every writer's records must be
+// present once and in order. Returns 1 if a record is torn, lost, repeated
+// or out of order.
+//
+// Build from the repository root:
+//   cl /EHsc /I. tools\append_stress.cpp LogWriter.cpp LogParser.cpp LogQuery.cpp LogArchive.cpp SummaryStream.cpp
+//      BlockSource.cpp IsoCalendar.cpp Tags.cpp Logger.cpp Metrics.cpp
+
+#include "LogWriter.h"
+#include "LogParser.h"
+#include "BlockSource.h"
+#include "Tags.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::system_clock;
+
+static Clock::time_point BaseTime() {
+    // Far from daylight saving changes, so local times format unambiguously
+    std::tm base = {};
+    base.tm_year = 124;
+    base.tm_mon = 0;
+    base.tm_mday = 8;
+    base.tm_hour = 6;
+    base.tm_isdst = -1;
+    return Clock::from_time_t(std::mktime(&base));
+}
+
+static std::string WriterTag(int writer) {
+    return "writer" + std::to_string(writer);
+}
+
+static int RunWriter(const std::string& fname, int writer, int records) {
+    LogRecord record;
+    record.day = 0;
+    record.kind = LogEventKind::Arrive;
+    record.tag = TagTable::Intern(WriterTag(writer));
+    Clock::time_point base = BaseTime();
+    for (int i = 0; i < records; i++) {
+        record.time = base + std::chrono::seconds(i);
+        if (!LogWriter::AppendRecord(fname, LogParser::FormatRecord(record))) {
+            std::fprintf(stderr, "writer %d: append %d failed\n", writer, i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#ifdef _WIN32
+
+// Runs every writer as a copy of this program with --writer=K
+static bool RunWriters(const char* self, const std::string& fname, int writers, int records) {
+    std::vector<PROCESS_INFORMATION> processes;
+    bool ok = true;
+    for (int writer = 0; writer < writers; writer++) {
+        std::string command = "\"" + std::string(self) + "\" --writer=" + std::to_string(writer) +
+                              " --records=" + std::to_string(records) + " \"--file=" + fname + "\"";
+        STARTUPINFOA startup = {};
+        startup.cb = sizeof(startup);
+        PROCESS_INFORMATION process = {};
+        if (!CreateProcessA(NULL, &command[0], NULL, NULL, FALSE, 0, NULL, NULL, &startup, &process)) {
+            ok = false;
+            break;
+        }
+        processes.push_back(process);
+    }
+    for (size_t i = 0; i < processes.size(); i++) {
+        DWORD exitCode = 1;
+        WaitForSingleObject(processes[i].hProcess, INFINITE);
+        GetExitCodeProcess(processes[i].hProcess, &exitCode);
+        ok = ok && exitCode == 0;
+        CloseHandle(processes[i].hThread);
+        CloseHandle(processes[i].hProcess);
+    }
+    return ok;
+}
+
+#else
+
+static bool RunWriters(const char*, const std::string& fname, int writers, int records) {
+    std::vector<pid_t> processes;
+    bool ok = true;
+    for (int writer = 0; writer < writers; writer++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(RunWriter(fname, writer, records));
+        }
+        if (pid < 0) {
+            ok = false;
+            break;
+        }
+        processes.push_back(pid);
+    }
+    for (size_t i = 0; i < processes.size(); i++) {
+        int status = 0;
+        ok = waitpid(processes[i], &status, 0) == processes[i] && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+    }
+    return ok;
+}
+
+#endif
+
+int main(int argc, char* argv[]) {
+    int writers = 8;
+    int records = 2000;
+    int writer = -1;
+    std::string dir = "append_stress";
+    std::string fname;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--writers=") == 0) {
+            writers = std::atoi(arg.c_str() + 10);
+        } else if (arg.find("--records=") == 0) {
+            records = std::atoi(arg.c_str() + 10);
+        } else if (arg.find("--dir=") == 0) {
+            dir = arg.substr(6);
+        } else if (arg.find("--writer=") == 0) {
+            writer = std::atoi(arg.c_str() + 9);
+        } else if (arg.find("--file=") == 0) {
+            fname = arg.substr(7);
+        }
+    }
+    if (writer >= 0) {
+        return RunWriter(fname, writer, records);
+    }
+    if (writers < 1 || records < 1) {
+        std::fprintf(stderr, "Usage: append_stress [--writers=N] [--records=N] [--dir=PATH]\n");
+        return 2;
+    }
+
+    mkdir(dir.c_str(), 0755);
+    fname = dir + "/Timelog.txt";
+    std::remove(fname.c_str());
+
+    auto start = std::chrono::steady_clock::now();
+    if (!RunWriters(argv[0], fname, writers, records)) {
+        std::fprintf(stderr, "A writer failed\n");
+        return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Next expected sequence number of every writer
+    std::vector<int> next(writers, 0);
+    std::vector<int> writerOf;
+    for (int w = 0; w < writers; w++) {
+        int tag = TagTable::Intern(WriterTag(w));
+        if ((int)writerOf.size() <= tag) {
+            writerOf.resize(tag + 1, -1);
+        }
+        writerOf[tag] = w;
+    }
+
+    Clock::time_point base = BaseTime();
+    LineReader reader(fname);
+    std::string line;
+    LogRecord record;
+    long long lines = 0;
+    int bad = 0;
+    while (reader.NextLine(line)) {
+        lines++;
+        int w = -1;
+        if (LogParser::ParseLine(line, record) && record.tag >= 0 && record.tag < (int)writerOf.size()) {
+            w = writerOf[record.tag];
+        }
+        long long sequence = std::chrono::duration_cast<std::chrono::seconds>(record.time - base).count();
+        if (w < 0 || sequence != next[w]) {
+            if (bad < 3) {
+                std::printf("line %lld: \"%s\"%s\n", lines, line.c_str(), w < 0 ? " is torn" : " is out of order");
+            }
+            bad++;
+            continue;
+        }
+        next[w]++;
+    }
+    for (int w = 0; w < writers; w++) {
+        if (next[w] != records) {
+            std::printf("writer %d: %d of %d records\n", w, next[w], records);
+            bad++;
+        }
+    }
+
+    std::printf("%d writers x %d records in %.1f ms, %lld lines, %d bad\n", writers, records, ms, lines, bad);
+    return bad == 0 ? 0 : 1;
+}
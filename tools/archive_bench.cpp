@@ -0,0 +1,174 @@
+// Size and speed benchmark of the log archive against the text log.
+//
+// Usage: archive_bench [--years=N] [--runs=N] [--dir=PATH] [LOG]
+// Archives LOG, or a synthetic log of N years (default 10) written to PATH
+// (default "archive_bench"), and reports:
+//   - text and archive size and their ratio
+//   - the median time over all runs (default 10) to aggregate daily summary
+//     rows from the text log and from the archive
+// Both must yield the same rows. Times include the page cache state of the
+// machine; the first run warms it. Returns 1 if the rows differ.
+//
+// Build from the repository root:
+//   cl /EHsc /O2 /I. tools\archive_bench.cpp LogArchive.cpp LogParser.cpp LogWriter.cpp SummaryStream.cpp
+//      BlockSource.cpp IsoCalendar.cpp Tags.cpp LogQuery.cpp Logger.cpp Metrics.cpp
+
+#include "LogArchive.h"
+#include "BlockSource.h"
+#include "LogParser.h"
+#include "LogWriter.h"
+#include "SummaryStream.h"
+#include "Tags.h"
+#include "ToolSupport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <sys/stat.h>
+#endif
+
+using Clock = std::chrono::system_clock;
+
+// Workdays with two or three sessions, a tag switch now and then
+static void WriteSyntheticLog(const std::string& fname, int years) {
+    std::ofstream log(fname, std::ios::binary | std::ios::trunc);
+    std::mt19937 random(5);
+    const int tags[3] = { TagTable::NO_TAG, TagTable::Intern("project-a"), TagTable::Intern("project-b") };
+    std::tm base = {};
+    base.tm_year = 110;
+    base.tm_mon = 0;
+    base.tm_mday = 4;
+    base.tm_isdst = -1;
+    for (int d = 0; d < years * 365; d++) {
+        if (d % 7 >= 5) {
+            continue;
+        }
+        std::tm day = base;
+        day.tm_mday += d;
+        day.tm_hour = 7;
+        day.tm_min = (int)(random() % 90);
+        Clock::time_point time = Clock::from_time_t(std::mktime(&day));
+        int sessions = 2 + random() % 2;
+        for (int s = 0; s < sessions; s++) {
+            log << Line(time, LogEventKind::Arrive, tags[random() % 3]);
+            time += std::chrono::minutes(60 + random() % 150);
+            if (random() % 4 == 0) {
+                log << Line(time, LogEventKind::Switch, tags[random() % 3]);
+                time += std::chrono::minutes(30 + random() % 60);
+            }
+            log << Line(time, s + 1 == sessions ? LogEventKind::LeaveClosed : LogEventKind::Leave, TagTable::NO_TAG);
+            time += std::chrono::minutes(20 + random() % 60);
+        }
+    }
+}
+
+static long long FileSize(const std::string& fname) {
+    std::ifstream file(fname, std::ios::binary | std::ios::ate);
+    return file.is_open() ? (long long)file.tellg() : 0;
+}
+
+static bool WriteArchiveOf(const std::string& logName, const std::string& archiveName) {
+    ArchiveWriter writer;
+    if (!writer.Open(archiveName)) {
+        return false;
+    }
+    LineReader reader(logName);
+    std::string line;
+    LogRecord record;
+    while (reader.NextLine(line)) {
+        if (LogParser::ParseLine(line, record)) {
+            writer.Add(record);
+        }
+    }
+    return writer.Close();
+}
+
+int main(int argc, char* argv[]) {
+    int years = 10;
+    int runs = 10;
+    std::string dir = "archive_bench";
+    std::string logName;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--years=") == 0) {
+            years = std::atoi(arg.c_str() + 8);
+        } else if (arg.find("--runs=") == 0) {
+            runs = std::atoi(arg.c_str() + 7);
+        } else if (arg.find("--dir=") == 0) {
+            dir = arg.substr(6);
+        } else {
+            logName = arg;
+        }
+    }
+    if (years < 1 || runs < 1) {
+        std::fprintf(stderr, "Usage: archive_bench [--years=N] [--runs=N] [--dir=PATH] [LOG]\n");
+        return 2;
+    }
+    mkdir(dir.c_str(), 0755);
+    if (logName.empty()) {
+        logName = dir + "/Timelog.txt";
+        WriteSyntheticLog(logName, years);
+    }
+    std::string archiveName = dir + "/Timelog_archive.dat";
+
+    auto start = std::chrono::steady_clock::now();
+    if (!WriteArchiveOf(logName, archiveName)) {
+        std::fprintf(stderr, "Could not archive %s\n", logName.c_str());
+        return 1;
+    }
+    double writeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    long long textBytes = FileSize(logName);
+    long long archiveBytes = FileSize(archiveName);
+    std::printf("text    %10lld bytes\narchive %10lld bytes, %.1fx smaller, written in %.1f ms\n", textBytes,
+                archiveBytes, archiveBytes > 0 ? (double)textBytes / archiveBytes : 0.0, writeMs);
+
+    std::vector<double> textTimes, archiveTimes;
+    std::vector<SummaryRow> textRows, archiveRows;
+    for (int run = 0; run < runs; run++) {
+        textRows.clear();
+        start = std::chrono::steady_clock::now();
+        SummaryStream text(SummaryGrouping::Daily, SummaryWindow::All(),
+                           [&textRows](const SummaryRow& row) { textRows.push_back(row); });
+        ScanLogSessions(logName, [&text](const LogSession& session) { text.AddSession(session); });
+        text.Finish();
+        textTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        archiveRows.clear();
+        start = std::chrono::steady_clock::now();
+        SummaryStream archived(SummaryGrouping::Daily, SummaryWindow::All(),
+                               [&archiveRows](const SummaryRow& row) { archiveRows.push_back(row); });
+        ArchiveReader reader;
+        SessionBuilder builder;
+        LogSession session;
+        reader.Open(archiveName);
+        reader.ReadAll([&](const LogRecord& record) {
+            if (builder.AddRecord(record, session)) {
+                archived.AddSession(session);
+            }
+            return true;
+        });
+        archived.Finish();
+        archiveTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    bool same = textRows.size() == archiveRows.size();
+    for (size_t i = 0; same && i < textRows.size(); i++) {
+        same = textRows[i].key == archiveRows[i].key && textRows[i].minutes == archiveRows[i].minutes;
+    }
+    double textMs = Median(textTimes);
+    double archiveMs = Median(archiveTimes);
+    std::printf("daily rows from text    %8.2f ms\ndaily rows from archive %8.2f ms, %.1fx faster\n", textMs,
+                archiveMs, archiveMs > 0 ? textMs / archiveMs : 0.0);
+    std::printf("%zu rows, %s\n", textRows.size(), same ? "identical" : "DIFFERENT");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,273 @@
+// Cold and warm cache benchmark of the log readers, wall time against CPU
+// time.
+//
+// Usage: block_source_bench [--mb=N] [--runs=N] [--parse] [--dir=PATH] [LOG]
+// Reads LOG, or a synthetic log of about N MB (default 128) written to PATH
+// (default "block_source_bench"), and checksums every line, or with --parse
+// parses it as a record, with:
+//   getline      std::ifstream and std::getline, the scanners' old reader
+//   LineReader   OpenBlockSource, the platform backend with read-ahead
+//   thread       the read-ahead thread backend under LineReader's splitting
+// Each reader runs cold (the file is evicted from the page cache first) and
+// warm, the median over all runs (default 5) is reported. CPU time is that
+// of the whole process, read-ahead thread included; wall time above it is
+// time spent waiting for the disk. All readers must see the same lines.
+// Returns 1 if they differ.
+//
+// The file is evicted with posix_fadvise(POSIX_FADV_DONTNEED), or on Windows
+// by opening it without buffering. Neither drops pages the drive or a
+// virtual machine's host still caches.
+//
+// Build from the repository root:
+//   cl /EHsc /O2 /I. tools\block_source_bench.cpp BlockSource.cpp LogParser.cpp LogQuery.cpp LogArchive.cpp
+//      SummaryStream.cpp LogWriter.cpp IsoCalendar.cpp Tags.cpp Logger.cpp Metrics.cpp
+
+#include "BlockSource.h"
+#include "LogParser.h"
+#include "LogWriter.h"
+#include "Tags.h"
+#include "ToolSupport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::system_clock;
+
+// Milliseconds of CPU time used by the process
+static double CpuMs() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (double)(k.QuadPart + u.QuadPart) / 10000.0;
+#else
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+#endif
+}
+
+// Evicts fname from the page cache; returns false if that is not possible
+static bool DropFileCache(const std::string& fname) {
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_FLAG_NO_BUFFERING, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    CloseHandle(hFile);
+    return true;
+#else
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+// Parsing costs far more CPU than reading; off by default so that the
+// I/O is not hidden behind it
+static bool parseRecords = false;
+
+// What every reader computes from the lines
+struct LineTally {
+    long long lines;
+    long long bytes;
+    uint32_t checksum;
+    long long records;
+
+    bool operator==(const LineTally& other) const {
+        return lines == other.lines && bytes == other.bytes && checksum == other.checksum &&
+               records == other.records;
+    }
+};
+
+static void Tally(const std::string& line, LineTally& tally) {
+    tally.lines++;
+    tally.bytes += (long long)line.size();
+    // FNV-1a over the line, chained from the previous one
+    uint32_t hash = tally.checksum ^ 2166136261u;
+    for (char c : line) {
+        hash = (hash ^ (unsigned char)c) * 16777619u;
+    }
+    tally.checksum = hash;
+    LogRecord record;
+    if (parseRecords && LogParser::ParseLine(line, record)) {
+        tally.records++;
+    }
+}
+
+static LineTally ReadGetline(const std::string& fname) {
+    LineTally tally = {};
+    std::ifstream file(fname, std::ios::binary);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        Tally(line, tally);
+    }
+    return tally;
+}
+
+static LineTally ReadLineReader(const std::string& fname) {
+    LineTally tally = {};
+    LineReader reader(fname);
+    std::string line;
+    while (reader.NextLine(line)) {
+        Tally(line, tally);
+    }
+    return tally;
+}
+
+// Same splitting as LineReader, on the thread backend
+static LineTally ReadThreadSource(const std::string& fname) {
+    LineTally tally = {};
+    std::unique_ptr<BlockSource> source = OpenThreadBlockSource(fname);
+    std::string line;
+    const char* data;
+    size_t size;
+    while (source && source->Next(data, size)) {
+        const char* end = data + size;
+        while (data < end) {
+            const char* newline = (const char*)std::memchr(data, '\n', (size_t)(end - data));
+            if (!newline) {
+                line.append(data, end);
+                break;
+            }
+            line.append(data, newline);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            Tally(line, tally);
+            line.clear();
+            data = newline + 1;
+        }
+    }
+    if (!line.empty()) {
+        Tally(line, tally);
+    }
+    return tally;
+}
+
+// Two sessions a day, one of them tagged, until the file has about mb MB
+static void WriteSyntheticLog(const std::string& fname, int mb) {
+    std::ofstream log(fname, std::ios::binary | std::ios::trunc);
+    int tag = TagTable::Intern("project-a");
+    std::tm base = {};
+    base.tm_year = 90;
+    base.tm_mon = 0;
+    base.tm_mday = 1;
+    base.tm_hour = 8;
+    base.tm_isdst = -1;
+    Clock::time_point day = Clock::from_time_t(std::mktime(&base));
+    long long bytes = 0;
+    std::string chunk;
+    while (bytes < (long long)mb * 1024 * 1024) {
+        chunk = Line(day, LogEventKind::Arrive, tag);
+        chunk += Line(day + std::chrono::hours(4), LogEventKind::LeaveClosed, TagTable::NO_TAG);
+        chunk += Line(day + std::chrono::hours(5), LogEventKind::Arrive, TagTable::NO_TAG);
+        chunk += Line(day + std::chrono::hours(9), LogEventKind::Leave, TagTable::NO_TAG);
+        log << chunk;
+        bytes += (long long)chunk.size();
+        day += std::chrono::hours(24);
+    }
+}
+
+struct Reader {
+    const char* name;
+    LineTally (*read)(const std::string& fname);
+};
+
+int main(int argc, char* argv[]) {
+    int mb = 128;
+    int runs = 5;
+    std::string dir = "block_source_bench";
+    std::string logName;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--mb=") == 0) {
+            mb = std::atoi(arg.c_str() + 5);
+        } else if (arg.find("--runs=") == 0) {
+            runs = std::atoi(arg.c_str() + 7);
+        } else if (arg == "--parse") {
+            parseRecords = true;
+        } else if (arg.find("--dir=") == 0) {
+            dir = arg.substr(6);
+        } else {
+            logName = arg;
+        }
+    }
+    if (mb < 1 || runs < 1) {
+        std::fprintf(stderr, "Usage: block_source_bench [--mb=N] [--runs=N] [--parse] [--dir=PATH] [LOG]\n");
+        return 2;
+    }
+    if (logName.empty()) {
+        mkdir(dir.c_str(), 0755);
+        logName = dir + "/Timelog.txt";
+        WriteSyntheticLog(logName, mb);
+    }
+
+    const Reader readers[] = {
+        { "getline", ReadGetline },
+        { "LineReader", ReadLineReader },
+        { "thread", ReadThreadSource },
+    };
+    bool canDrop = DropFileCache(logName);
+    if (!canDrop) {
+        std::printf("the file cannot be evicted; cold runs are warm\n");
+    }
+
+    LineTally first = {};
+    bool same = true;
+    std::printf("%-10s %10s %10s %10s %10s\n", "", "cold wall", "cold cpu", "warm wall", "warm cpu");
+    for (const Reader& reader : readers) {
+        std::vector<double> wall[2], cpu[2];
+        for (int run = 0; run < runs; run++) {
+            for (int warm = 0; warm < 2; warm++) {
+                if (!warm) {
+                    DropFileCache(logName);
+                }
+                double cpuStart = CpuMs();
+                auto start = std::chrono::steady_clock::now();
+                LineTally tally = reader.read(logName);
+                wall[warm].push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                cpu[warm].push_back(CpuMs() - cpuStart);
+
+                if (first.lines == 0) {
+                    first = tally;
+                }
+                same = same && tally == first;
+            }
+        }
+        std::printf("%-10s %7.1f ms %7.1f ms %7.1f ms %7.1f ms\n", reader.name, Median(wall[0]), Median(cpu[0]),
+                    Median(wall[1]), Median(cpu[1]));
+    }
+    std::printf("%lld lines, %lld bytes, %lld records, %s\n", first.lines, first.bytes, first.records,
+                same ? "identical" : "DIFFERENT");
+    return same ? 0 : 1;
+}
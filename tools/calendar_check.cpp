@@ -0,0 +1,119 @@
+// Exhaustive check of the serial-day calendar against the C library.
+//
+// Usage: calendar_check [--from=YEAR] [--to=YEAR]
+// For every day of the years given (default 1970 to 2100, the range of the
+// compile-time table) compares with gmtime and strftime:
+//   - CivilFromDays and DaysFromCivil, both ways
+//   - Weekday against %u
+//   - DateKey against %d.%m.%Y and WeekKey against %G-W%V
+//   - ParseIsoDate of %Y-%m-%d
+// and with mktime LocalDayNumber at noon local time. Local dates the time
+// zone skipped, and times system_clock cannot hold, are counted but not
+// compared. Years outside the table exercise the run-time fallback.
+// Malformed and nonexistent dates must be rejected by ParseIsoDate.
+// Returns 1 on a mismatch.
+//
+// Build from the repository root:
+//   cl /EHsc /I. tools\calendar_check.cpp IsoCalendar.cpp
+
+#include "IsoCalendar.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+static std::tm UtcDate(std::time_t time) {
+    std::tm tm;
+#ifdef _WIN32
+    gmtime_s(&tm, &time);
+#else
+    gmtime_r(&time, &tm);
+#endif
+    return tm;
+}
+
+static std::string Format(const char* format, const std::tm& tm) {
+    char buffer[32];
+    return std::string(buffer, std::strftime(buffer, sizeof(buffer), format, &tm));
+}
+
+int main(int argc, char* argv[]) {
+    int fromYear = IsoCalendar::TABLE_FIRST_YEAR;
+    int toYear = IsoCalendar::TABLE_LAST_YEAR;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--from=") == 0) {
+            fromYear = std::atoi(arg.c_str() + 7);
+        } else if (arg.find("--to=") == 0) {
+            toYear = std::atoi(arg.c_str() + 5);
+        }
+    }
+    // gmtime before 1970 is not portable
+    if (fromYear < 1970 || toYear < fromYear) {
+        std::fprintf(stderr, "Usage: calendar_check [--from=YEAR] [--to=YEAR], from 1970 on\n");
+        return 2;
+    }
+
+    int first = IsoCalendar::DaysFromCivil(fromYear, 1, 1);
+    int last = IsoCalendar::DaysFromCivil(toYear, 12, 31);
+    int bad = 0;
+    int skipped = 0;
+    int parsed;
+    // With nanosecond ticks system_clock ends in 2262
+    const std::time_t latest = std::chrono::system_clock::to_time_t(std::chrono::system_clock::time_point::max()) - 86400;
+    for (int days = first; days <= last; days++) {
+        std::tm utc = UtcDate((std::time_t)days * 86400);
+        CivilDate date = IsoCalendar::CivilFromDays(days);
+        std::string what;
+        if (date.year != utc.tm_year + 1900 || date.month != utc.tm_mon + 1 || date.day != utc.tm_mday) {
+            what = "CivilFromDays";
+        } else if (IsoCalendar::DaysFromCivil(utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday) != days) {
+            what = "DaysFromCivil";
+        } else if (std::to_string(IsoCalendar::Weekday(days)) != Format("%u", utc)) {
+            what = "Weekday";
+        } else if (IsoCalendar::DateKey(days) != Format("%d.%m.%Y", utc)) {
+            what = "DateKey " + IsoCalendar::DateKey(days);
+        } else if (IsoCalendar::WeekKey(days) != Format("%G-W%V", utc)) {
+            what = "WeekKey " + IsoCalendar::WeekKey(days);
+        } else if (!IsoCalendar::ParseIsoDate(Format("%Y-%m-%d", utc), parsed) || parsed != days) {
+            what = "ParseIsoDate";
+        }
+
+        // Noon is clear of daylight saving changes in every time zone
+        std::tm local = {};
+        local.tm_year = utc.tm_year;
+        local.tm_mon = utc.tm_mon;
+        local.tm_mday = utc.tm_mday;
+        local.tm_hour = 12;
+        local.tm_isdst = -1;
+        std::time_t noon = std::mktime(&local);
+        if (noon == (std::time_t)-1 || local.tm_mday != utc.tm_mday || noon > latest) {
+            skipped++;
+        } else if (what.empty() &&
+                   IsoCalendar::LocalDayNumber(std::chrono::system_clock::from_time_t(noon)) != days) {
+            what = "LocalDayNumber";
+        }
+
+        if (!what.empty()) {
+            if (bad < 10) {
+                std::printf("%s: %s differs\n", Format("%Y-%m-%d", utc).c_str(), what.c_str());
+            }
+            bad++;
+        }
+    }
+
+    const char* invalid[] = { "", "2024", "2024-01", "2024-01-01x", "2024/01/01", "24-1-1x", "2024-00-10",
+                              "2024-13-01", "2024-01-00", "2024-01-32", "2023-02-29", "2024-02-30", "2024-04-31",
+                              "-2024-01-01", " 2024-01-01", "20240-01-01" };
+    for (const char* text : invalid) {
+        if (IsoCalendar::ParseIsoDate(std::string(text), parsed)) {
+            std::printf("\"%s\" accepted\n", text);
+            bad++;
+        }
+    }
+
+    std::printf("%d days of %d-%d, %d wrong, %d without local check\n", last - first + 1, fromYear, toYear, bad,
+                skipped);
+    return bad == 0 ? 0 : 1;
+}
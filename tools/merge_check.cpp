@@ -0,0 +1,145 @@
+// Correctness check of the log merge.
+//
+// Usage: merge_check [--trials=N] [--dir=PATH]
+// Writes random logs of 1 to 5 devices to PATH (default "merge_check") and
+// merges them. They contain tagged ARRIVEs, SWITCHes, crash-terminated
+// LEAVEs, repeated ARRIVEs and open sessions at the end; every third trial
+// shifts one device's clock and corrects it with the source offset.
+// For every trial:
+//   - the merged minutes equal the minutes covered by any device
+//   - merged sessions are in order and do not overlap
+//   - a merged log written with WriteMergedLog and parsed again yields the
+//     same sessions, tags included
+// Returns 1 if any check fails.
+//
+// Build from the repository root:
+//   cl /EHsc /I. tools\merge_check.cpp LogMerge.cpp LogParser.cpp SummaryStream.cpp LogArchive.cpp
+//      LogQuery.cpp LogWriter.cpp BlockSource.cpp IsoCalendar.cpp Tags.cpp Logger.cpp Metrics.cpp
+
+#include "LogMerge.h"
+#include "LogParser.h"
+#include "Tags.h"
+#include "ToolSupport.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <sys/stat.h>
+#endif
+
+using Clock = std::chrono::system_clock;
+
+static bool SameSessions(const std::vector<LogSession>& a, const std::vector<LogSession>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].arrive != b[i].arrive || a[i].leave != b[i].leave || a[i].tag != b[i].tag ||
+            a[i].day != b[i].day || a[i].minutes != b[i].minutes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int trials = 300;
+    std::string dir = "merge_check";
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--trials=") == 0) {
+            trials = std::atoi(arg.c_str() + 9);
+        } else if (arg.find("--dir=") == 0) {
+            dir = arg.substr(6);
+        }
+    }
+    mkdir(dir.c_str(), 0755);
+
+    // Far from daylight saving changes, so local times format unambiguously
+    std::tm base = {};
+    base.tm_year = 124;
+    base.tm_mon = 0;
+    base.tm_mday = 8;
+    base.tm_hour = 6;
+    base.tm_isdst = -1;
+    const Clock::time_point start = Clock::from_time_t(std::mktime(&base));
+    const char* tags[3] = { "", "alpha", "beta" };
+
+    std::mt19937 random(7);
+    int failed = 0;
+    for (int trial = 0; trial < trials; trial++) {
+        int devices = 1 + random() % 5;
+        int skew = trial % 3 == 0 ? (int)(random() % 600) - 300 : 0;
+        std::set<int> covered;  // minutes since start worked on any device
+        std::vector<MergeSource> sources;
+
+        for (int device = 0; device < devices; device++) {
+            std::string fname = dir + "/device" + std::to_string(device) + ".txt";
+            std::ofstream log(fname, std::ios::binary | std::ios::trunc);
+            int shift = device == 1 ? skew : 0;
+            auto at = [&](int minute) { return start + std::chrono::minutes(minute) + std::chrono::seconds(shift); };
+
+            int minute = random() % 120;
+            for (int session = 0; session < 30; session++) {
+                minute += random() % 400;
+                int length = 1 + random() % 300;
+                log << Line(at(minute), LogEventKind::Arrive, tags[random() % 3]);
+                if (random() % 10 == 0) {
+                    log << Line(at(minute), LogEventKind::Arrive, "");  // restarted after a crash
+                }
+                if (length > 2 && random() % 3 == 0) {
+                    log << Line(at(minute + length / 2), LogEventKind::Switch, tags[random() % 3]);
+                }
+                log << Line(at(minute + length), random() % 4 == 0 ? LogEventKind::LeaveTerminated : LogEventKind::Leave, "");
+                for (int m = minute; m < minute + length; m++) {
+                    covered.insert(m);
+                }
+                minute += length;
+            }
+            if (random() % 2) {
+                log << Line(at(minute + 5), LogEventKind::Arrive, "");  // still open, not counted
+            }
+            sources.push_back(MergeSource(fname, -shift));
+        }
+
+        std::vector<LogSession> merged;
+        MergeLogSessions(sources, [&merged](const LogSession& session) { merged.push_back(session); });
+        long long total = 0;
+        bool ordered = true;
+        for (size_t i = 0; i < merged.size(); i++) {
+            total += merged[i].minutes;
+            if (i > 0 && merged[i].arrive < merged[i - 1].leave) {
+                ordered = false;
+            }
+        }
+        if (total != (long long)covered.size() || !ordered) {
+            std::printf("trial %d: %lld merged minutes, %zu covered, ordered %d\n", trial, total, covered.size(), ordered);
+            failed++;
+            continue;
+        }
+
+        std::string outName = dir + "/merged.txt";
+        std::vector<LogSession> reparsed;
+        if (!WriteMergedLog(sources, outName) ||
+            !ScanLogSessions(outName, [&reparsed](const LogSession& session) { reparsed.push_back(session); }) ||
+            !SameSessions(merged, reparsed)) {
+            std::printf("trial %d: merged log reads back %zu sessions, %zu merged\n", trial, reparsed.size(), merged.size());
+            failed++;
+        }
+    }
+
+    bool refused = !WriteMergedLog(std::vector<MergeSource>(1, MergeSource(dir + "/merged.txt")), dir + "/merged.txt") &&
+                   !MergeLogSessions(std::vector<MergeSource>(1, MergeSource(dir + "/missing.txt")),
+                                     [](const LogSession&) {});
+    std::printf("%d of %d trials pass, bad arguments %s\n", trials - failed, trials, refused ? "refused" : "ACCEPTED");
+    return failed == 0 && refused ? 0 : 1;
+}
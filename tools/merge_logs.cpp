@@ -0,0 +1,56 @@
+// Merges the time logs of several devices so overlapping time counts once.
+//
+// Usage: merge_logs [--out=FILE | --daily | --weekly] LOG[@SECONDS]...
+//   merge_logs --out=Timelog_merged.txt laptop\Timelog.txt desktop\Timelog.txt
+//   merge_logs --weekly laptop\Timelog.txt desktop\Timelog.txt@-90
+// "@SECONDS" shifts all times of that log to correct its clock.
+//
+// Build from the repository root:
+//   cl /EHsc /I. tools\merge_logs.cpp LogMerge.cpp LogParser.cpp SummaryStream.cpp LogArchive.cpp
+//      LogQuery.cpp LogWriter.cpp BlockSource.cpp IsoCalendar.cpp Tags.cpp Logger.cpp Metrics.cpp
+
+#include "LogMerge.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    std::string outName;
+    bool summary = false;
+    SummaryGrouping grouping = SummaryGrouping::Daily;
+    std::vector<MergeSource> sources;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--out=") == 0) {
+            outName = arg.substr(6);
+        } else if (arg == "--daily" || arg == "--weekly") {
+            summary = true;
+            grouping = arg == "--daily" ? SummaryGrouping::Daily : SummaryGrouping::Weekly;
+        } else {
+            size_t at = arg.rfind('@');
+            if (at == std::string::npos) {
+                sources.push_back(MergeSource(arg));
+            } else {
+                sources.push_back(MergeSource(arg.substr(0, at), std::atoi(arg.c_str() + at + 1)));
+            }
+        }
+    }
+    if (sources.empty() || (outName.empty() == !summary)) {
+        std::fprintf(stderr, "Usage: merge_logs [--out=FILE | --daily | --weekly] LOG[@SECONDS]...\n");
+        return 2;
+    }
+
+    if (summary) {
+        bool ok = MergeSummary(sources, grouping, SummaryWindow::All(), [](const SummaryRow& row) {
+            std::printf("%s: %d:%02d\n", row.key.c_str(), row.minutes / 60, row.minutes % 60);
+        });
+        return ok ? 0 : 1;
+    }
+    if (!WriteMergedLog(sources, outName)) {
+        std::fprintf(stderr, "Could not merge into %s\n", outName.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+// Command line client for the TimeRecording query endpoint.
+//
+// Usage: query_client [--endpoint=NAME] REQUEST...
+//   query_client STATE
+//   query_client RANGE 2025-01-01 2025-01-31
+//
+// Build from the repository root:
+//   cl /EHsc /I. tools\query_client.cpp QueryServer.cpp Logger.cpp advapi32.lib
+
+#include "QueryServer.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    std::string endpoint = QueryServer::DefaultEndpoint();
+    std::string request;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--endpoint=") == 0) {
+            endpoint = arg.substr(11);
+        } else {
+            request += (request.empty() ? "" : " ") + arg;
+        }
+    }
+    if (request.empty()) {
+        std::fprintf(stderr, "Usage: query_client [--endpoint=NAME] STATE|TODAY|WEEK|RANGE|DAYS|TOP ...\n");
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string response;
+    if (!SendQuery(endpoint, request, response)) {
+        std::fprintf(stderr, "No TimeRecording query endpoint at %s\n", endpoint.c_str());
+        return 1;
+    }
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::fputs(response.c_str(), stdout);
+    std::fprintf(stderr, "(%lld us)\n", (long long)micros);
+    return response.compare(0, 6, "error=") == 0 ? 1 : 0;
+}
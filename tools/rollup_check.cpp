@@ -0,0 +1,175 @@
+// Consistency check of the incremental day rollup.
+//
+// Usage: rollup_check [--trials=N] [--dir=PATH]
+// Writes random logs with ARRIVE, SWITCH and LEAVE records line by line to
+// PATH (default "rollup_check"). After every line the rollup is saved,
+// loaded and caught up, like on every launch. Its day totals must match
+// those of ScanLogSessions over the whole log. A session switched to
+// another tag after midnight must count the same for the day in the rollup
+// and in the day restored by LogTailScanner. Returns 1 on a mismatch.
+//
+// Build from the repository root:
+//   cl /EHsc /I. tools\rollup_check.cpp DayRollup.cpp LogTailScanner.cpp LogArchive.cpp LogParser.cpp LogWriter.cpp
+//      BlockSource.cpp IsoCalendar.cpp Tags.cpp LogQuery.cpp SummaryStream.cpp Logger.cpp Metrics.cpp
+
+#include "DayRollup.h"
+#include "LogTailScanner.h"
+#include "LogParser.h"
+#include "LogWriter.h"
+#include "Tags.h"
+#include "IsoCalendar.h"
+#include "ToolSupport.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <sys/stat.h>
+#endif
+
+using Clock = std::chrono::system_clock;
+
+// Random log lines, a few hours apart, crossing midnight now and then
+static std::vector<std::string> MakeLines(std::mt19937& random, int count) {
+    const int tags[3] = { TagTable::NO_TAG, TagTable::Intern("alpha"), TagTable::Intern("beta") };
+    std::vector<std::string> lines;
+    Clock::time_point time = Clock::now() - std::chrono::hours(24 * 60);
+    for (int i = 0; i < count; i++) {
+        time += std::chrono::minutes(1 + random() % 300);
+        int tag = tags[random() % 3];
+        switch (random() % 4) {
+            case 0: lines.push_back(Line(time, LogEventKind::Arrive, tag)); break;
+            case 1: lines.push_back(Line(time, LogEventKind::Switch, tag)); break;
+            case 2: lines.push_back(Line(time, LogEventKind::Leave, TagTable::NO_TAG)); break;
+            default: lines.push_back(Line(time, LogEventKind::LeaveTerminated, TagTable::NO_TAG)); break;
+        }
+    }
+    return lines;
+}
+
+static std::map<int, int> FullScan(const std::string& logName) {
+    std::map<int, int> days;
+    ScanLogSessions(logName, [&days](const LogSession& session) {
+        days[session.day] += session.minutes;
+    });
+    return days;
+}
+
+static bool Matches(const DayRollup& rollup, const std::map<int, int>& days) {
+    int64_t total = 0;
+    for (const auto& day : days) {
+        if (rollup.Minutes(day.first) != day.second) {
+            return false;
+        }
+        total += day.second;
+    }
+    return rollup.IsEmpty() ? total == 0 : rollup.Sum(rollup.FirstDay(), rollup.LastDay()) == total;
+}
+
+// 08:00 ARRIVE, 10:00 SWITCH, 12:00 LEAVE, caught up after each line: 240
+static bool CheckSwitchDay(const std::string& dir) {
+    std::string logName = dir + "/Timelog.txt";
+    std::string rollupName = dir + "/Timelog_rollup.dat";
+    std::remove(logName.c_str());
+    std::remove(rollupName.c_str());
+
+    Clock::time_point morning = Clock::now() - std::chrono::hours(24 * 7);
+    std::time_t tt = Clock::to_time_t(morning);
+    std::tm tm = *std::localtime(&tt);
+    tm.tm_hour = 8;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    morning = Clock::from_time_t(std::mktime(&tm));
+
+    const std::string lines[3] = {
+        Line(morning, LogEventKind::Arrive, TagTable::Intern("alpha")),
+        Line(morning + std::chrono::hours(2), LogEventKind::Switch, TagTable::Intern("beta")),
+        Line(morning + std::chrono::hours(4), LogEventKind::Leave, TagTable::NO_TAG),
+    };
+    DayRollup rollup;
+    for (const std::string& line : lines) {
+        LogWriter::AppendRecord(logName, line.substr(0, line.size() - std::string(LOG_LINE_END).size()));
+        rollup.CatchUp(logName);
+    }
+    int minutes = rollup.IsEmpty() ? 0 : (int)rollup.Sum(rollup.FirstDay(), rollup.LastDay());
+    std::printf("switch day: %d minutes, expected 240\n", minutes);
+    return minutes == 240;
+}
+
+// 22:00 ARRIVE, 01:00 SWITCH, 03:00 LEAVE: 120 minutes on the second day
+static bool CheckMidnightSwitch(const std::string& dir) {
+    std::string logName = dir + "/Timelog.txt";
+    std::remove(logName.c_str());
+
+    Clock::time_point evening = Clock::now() - std::chrono::hours(24 * 7);
+    std::time_t tt = Clock::to_time_t(evening);
+    std::tm tm = *std::localtime(&tt);
+    tm.tm_hour = 22;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    evening = Clock::from_time_t(std::mktime(&tm));
+    Clock::time_point night = evening + std::chrono::hours(3);
+
+    std::ofstream(logName, std::ios::binary | std::ios::trunc)
+        << Line(evening, LogEventKind::Arrive, TagTable::Intern("alpha"))
+        << Line(night, LogEventKind::Switch, TagTable::Intern("beta"))
+        << Line(night + std::chrono::hours(2), LogEventKind::Leave, TagTable::NO_TAG);
+    DayRollup rollup;
+    rollup.CatchUp(logName);
+    DaySummary restored;
+    LogTailScanner::SummarizeDay(logName, night, restored);
+    int64_t minutes = rollup.Minutes(IsoCalendar::LocalDayNumber(night));
+    std::printf("midnight switch: rollup %lld, restored %d minutes, expected 120\n", (long long)minutes,
+                restored.minutesWorked);
+    return minutes == 120 && restored.minutesWorked == 120;
+}
+
+int main(int argc, char* argv[]) {
+    int trials = 200;
+    std::string dir = "rollup_check";
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--trials=") == 0) {
+            trials = std::atoi(arg.c_str() + 9);
+        } else if (arg.find("--dir=") == 0) {
+            dir = arg.substr(6);
+        }
+    }
+    mkdir(dir.c_str(), 0755);
+
+    bool ok = CheckSwitchDay(dir);
+    ok = CheckMidnightSwitch(dir) && ok;
+    std::string logName = dir + "/Timelog.txt";
+    std::string rollupName = dir + "/Timelog_rollup.dat";
+    std::mt19937 random(42);
+    int failed = 0;
+    for (int trial = 0; trial < trials; trial++) {
+        std::vector<std::string> lines = MakeLines(random, 40);
+        std::ofstream(logName, std::ios::binary | std::ios::trunc);
+        std::remove(rollupName.c_str());
+
+        for (const std::string& line : lines) {
+            std::ofstream(logName, std::ios::binary | std::ios::app) << line;
+            DayRollup rollup;
+            rollup.Load(rollupName);
+            rollup.CatchUp(logName);
+            rollup.Save(rollupName);
+        }
+        DayRollup rollup;
+        rollup.Load(rollupName);
+        if (!Matches(rollup, FullScan(logName))) {
+            std::printf("trial %d: rollup differs from the full scan\n", trial);
+            failed++;
+        }
+    }
+    std::printf("%d of %d random logs match\n", trials - failed, trials);
+    return ok && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// Startup latency harness for the platform-neutral part of a launch
+// (RunStartup: crash recovery, rollup, calendar, today's minutes, ARRIVE).
+//
+// Usage: startup_bench [--days=N] [--runs=N] [--dir=PATH]
+// Writes a synthetic log of N days (default 3650) to PATH (default
+// "startup_bench") and times RunStartup on a fresh copy of it per run:
+//   cold  no rollup file, the whole log is aggregated
+//   warm  rollup file of the previous launch, only the tail is read
+// Both runs start with a crash record to recover. Times include the page
+// cache state of the machine; drop caches between runs to see cold I/O.
+//
+// Build on Linux from the repository root:
+//   g++ -O2 -std=c++14 -I. tools/startup_bench.cpp StartupTask.cpp DayRollup.cpp WorkCalendar.cpp
+//       LogArchive.cpp LogQuery.cpp LogTailScanner.cpp LogParser.cpp LogWriter.cpp SummaryStream.cpp
+//       BlockSource.cpp IsoCalendar.cpp Tags.cpp Logger.cpp Metrics.cpp -lpthread -o startup_bench
+
+#include "StartupTask.h"
+#include "LogParser.h"
+#include "LogWriter.h"
+#include "Tags.h"
+#include "ToolSupport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+using Clock = std::chrono::system_clock;
+
+// Two sessions per day, ending yesterday
+static std::string MakeLog(int days, Clock::time_point now) {
+    std::string log;
+    auto midnight = now - std::chrono::hours(24);
+    for (int d = days; d >= 1; d--) {
+        auto day = midnight - std::chrono::hours(24 * (d - 1));
+        log += Line(day - std::chrono::hours(6), LogEventKind::Arrive);
+        log += Line(day - std::chrono::hours(3), LogEventKind::LeaveClosed);
+        log += Line(day - std::chrono::hours(2), LogEventKind::Arrive);
+        log += Line(day, LogEventKind::Leave);
+    }
+    // Today's first session, ended by a crash
+    log += Line(now - std::chrono::minutes(90), LogEventKind::Arrive);
+    return log;
+}
+
+static void WriteFile(const std::string& fname, const std::string& data) {
+    std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+    out << data;
+}
+
+static double RunOnce(const std::string& dir, const std::string& log, const std::string& rollup,
+                      Clock::time_point now) {
+    StartupPlan plan;
+    plan.logName = dir + "/Timelog.txt";
+    plan.tmpName = dir + "/Timelog_tmp.txt";
+    plan.rollupName = dir + "/Timelog_rollup.dat";
+    plan.archiveName = dir + "/Timelog_archive.dat";
+    plan.calendarName = dir + "/Timelog_calendar.txt";
+    plan.arriveTime = now;
+
+    WriteFile(plan.logName, log);
+    WriteFile(plan.tmpName, Line(now - std::chrono::minutes(30), LogEventKind::LeaveTerminated));
+    if (rollup.empty()) {
+        std::remove(plan.rollupName.c_str());
+    } else {
+        WriteFile(plan.rollupName, rollup);
+    }
+
+    DayRollup dayRollup;
+    WorkCalendar calendar;
+    StartupResult result;
+    auto start = std::chrono::steady_clock::now();
+    RunStartup(plan, dayRollup, calendar, result);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // The recovered session of today; differs only shortly after midnight
+    if (result.minutesEarlierToday != 60) {
+        std::fprintf(stderr, "Minutes today: %u, expected 60\n", result.minutesEarlierToday);
+    }
+    return ms;
+}
+
+static void Report(const char* name, std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    std::printf("%-5s min %8.3f  median %8.3f  p95 %8.3f  max %8.3f ms\n", name, times.front(),
+                times[times.size() / 2], times[std::min(times.size() - 1, times.size() * 95 / 100)], times.back());
+}
+
+int main(int argc, char* argv[]) {
+    int days = 3650;
+    int runs = 20;
+    std::string dir = "startup_bench";
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--days=") == 0) {
+            days = std::atoi(arg.c_str() + 7);
+        } else if (arg.find("--runs=") == 0) {
+            runs = std::atoi(arg.c_str() + 7);
+        } else if (arg.find("--dir=") == 0) {
+            dir = arg.substr(6);
+        }
+    }
+    if (days < 1 || runs < 1) {
+        std::fprintf(stderr, "Usage: startup_bench [--days=N] [--runs=N] [--dir=PATH]\n");
+        return 2;
+    }
+    mkdir(dir.c_str(), 0755);
+
+    Clock::time_point now = Clock::now();
+    std::string log = MakeLog(days, now);
+    std::printf("log: %d days, %zu bytes\n", days, log.size());
+
+    std::vector<double> cold, warm;
+    for (int run = 0; run < runs; run++) {
+        cold.push_back(RunOnce(dir, log, std::string(), now));
+    }
+
+    // Rollup as the previous launch left it: covering the log before today's
+    // crash record
+    std::string rollupName = dir + "/Timelog_rollup.dat";
+    std::remove(rollupName.c_str());
+    WriteFile(dir + "/Timelog.txt", log);
+    DayRollup previous;
+    previous.CatchUp(dir + "/Timelog.txt");
+    previous.Save(rollupName);
+    std::ifstream in(rollupName, std::ios::binary);
+    std::string rollup((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    for (int run = 0; run < runs; run++) {
+        warm.push_back(RunOnce(dir, log, rollup, now));
+    }
+
+    Report("cold", cold);
+    Report("warm", warm);
+    return 0;
+}
@@ -0,0 +1,197 @@
+// Consistency check of the paged summary row provider.
+//
+// Usage: summary_rows_check [--days=N] [--dir=PATH]
+// Writes a log of N days (default 900) to PATH (default "summary_rows_check").
+// On about half of the days an evening session SWITCHes its tag after
+// midnight, so the next day's row starts with a SWITCH. Every row that
+// LogSummaryRowProvider returns, read last to first so every page is loaded
+// from its recorded start, must match one streaming pass over the sessions.
+// This runs daily and weekly, first on the log alone and then with its
+// first half moved to an archive. Date range queries (ScanFilteredSessions),
+// which enter the log at the first line of a day, must count the same
+// sessions as a full pass. A second log puts a SWITCH at midnight first in
+// an archive block, so that a range from that day enters the archive at a
+// SWITCH. Returns 1 on a mismatch.
+//
+// Build from the repository root:
+//   cl /EHsc /I. tools\summary_rows_check.cpp SummaryRowProvider.cpp SummaryStream.cpp LogArchive.cpp
+//      LogQuery.cpp LogParser.cpp LogWriter.cpp BlockSource.cpp IsoCalendar.cpp Tags.cpp Logger.cpp Metrics.cpp
+
+#include "SummaryRowProvider.h"
+#include "LogQuery.h"
+#include "LogArchive.h"
+#include "LogParser.h"
+#include "IsoCalendar.h"
+#include "Tags.h"
+#include "ToolSupport.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <sys/stat.h>
+#endif
+
+using Clock = std::chrono::system_clock;
+
+// Rows of one streaming pass over the archive and the log
+static std::vector<SummaryRow> StreamRows(const std::string& logName, const std::string& archiveName,
+                                          SummaryGrouping grouping) {
+    std::vector<SummaryRow> rows;
+    SummaryStream stream(grouping, SummaryWindow::All(), [&rows](const SummaryRow& row) { rows.push_back(row); });
+    ScanHistorySessions(logName, archiveName, [&stream](const LogSession& session) {
+        stream.AddSession(session);
+    });
+    stream.Finish();
+    return rows;
+}
+
+static int Check(const std::string& logName, const std::string& archiveName, SummaryGrouping grouping) {
+    std::vector<SummaryRow> expected = StreamRows(logName, archiveName, grouping);
+    LogSummaryRowProvider provider(logName, grouping, SummaryWindow::All(), archiveName);
+    int bad = provider.GetRowCount() == (int)expected.size() ? 0 : 1;
+    for (int i = (int)expected.size() - 1; i >= 0; i--) {
+        SummaryRow row;
+        if (!provider.GetRow(i, row) || row.key != expected[i].key || row.minutes != expected[i].minutes) {
+            if (bad < 3) {
+                std::printf("row %d: %s %d, expected %s %d\n", i, row.key.c_str(), row.minutes,
+                            expected[i].key.c_str(), expected[i].minutes);
+            }
+            bad++;
+        }
+    }
+    std::printf("%-7s %-6s %zu rows, %d wrong\n", archiveName.empty() ? "log" : "archive",
+                grouping == SummaryGrouping::Daily ? "daily" : "weekly", expected.size(), bad);
+    return bad;
+}
+
+// Three-week ranges starting on every weekday of the log
+static int CheckRanges(const std::string& logName, const std::string& archiveName, int firstDay, int days) {
+    int bad = 0;
+    for (int from = firstDay - 1; from <= firstDay + days; from += 5) {
+        SessionFilter filter;
+        filter.fromDay = from;
+        filter.toDay = from + 20;
+        long long expected = 0;
+        long long found = 0;
+        ScanHistorySessions(logName, archiveName, [&](const LogSession& session) {
+            LogSession clipped = session;
+            if (filter.Apply(clipped)) {
+                expected += clipped.minutes;
+            }
+        });
+        ScanFilteredSessions(logName, archiveName, filter, [&found](const LogSession& session) {
+            found += session.minutes;
+        });
+        if (found != expected) {
+            if (bad < 3) {
+                std::printf("range from day %d: %lld minutes, expected %lld\n", from, found, expected);
+            }
+            bad++;
+        }
+    }
+    std::printf("%-7s ranges, %d wrong\n", archiveName.empty() ? "log" : "archive", bad);
+    return bad;
+}
+
+// One session a day for a block of records less two, then an evening
+// session SWITCHed at 22:00 and at midnight, so the second block starts
+// with the midnight SWITCH. Ranges from that day on must count it.
+static int CheckArchivedSwitch(const std::string& dir, Clock::time_point start, int alpha, int beta) {
+    std::string logName = dir + "/Timelog_switch.txt";
+    std::string archiveName = dir + "/Timelog_switch_archive.dat";
+    std::remove(archiveName.c_str());
+    std::ofstream log(logName, std::ios::binary | std::ios::trunc);
+    int days = (int)(ArchiveWriter::RECORDS_PER_BLOCK - 2) / 2;
+    for (int d = 0; d < days; d++) {
+        Clock::time_point morning = start + std::chrono::hours(24 * d);
+        log << Line(morning, LogEventKind::Arrive, alpha);
+        log << Line(morning + std::chrono::hours(4), LogEventKind::Leave, TagTable::NO_TAG);
+    }
+    std::time_t tt = Clock::to_time_t(start + std::chrono::hours(24 * days + 12));
+    std::tm tm = *std::localtime(&tt);
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_mday++;
+    tm.tm_isdst = -1;
+    Clock::time_point midnight = Clock::from_time_t(std::mktime(&tm));
+    log << Line(midnight - std::chrono::hours(4), LogEventKind::Arrive, alpha);
+    log << Line(midnight - std::chrono::hours(2), LogEventKind::Switch, beta);
+    log << Line(midnight, LogEventKind::Switch, alpha);
+    log << Line(midnight + std::chrono::hours(2), LogEventKind::Leave, TagTable::NO_TAG);
+    for (int d = days + 1; d < days + 10; d++) {
+        Clock::time_point morning = start + std::chrono::hours(24 * d);
+        log << Line(morning, LogEventKind::Arrive, beta);
+        log << Line(morning + std::chrono::hours(4), LogEventKind::Leave, TagTable::NO_TAG);
+    }
+    log.close();
+
+    int switchDay = IsoCalendar::LocalDayNumber(midnight);
+    ArchiveLogBefore(logName, archiveName, switchDay + 5);
+    ArchiveReader archive;
+    bool atBlockStart = archive.Open(archiveName) && archive.BlockCount() > 1 &&
+                        archive.BlockFirstTime(1) == (int64_t)Clock::to_time_t(midnight);
+    int bad = (atBlockStart ? 0 : 1) + CheckRanges(logName, archiveName, switchDay + 1, 6);
+    std::printf("archive block starting with a SWITCH%s\n", atBlockStart ? "" : " NOT BUILT");
+    return bad;
+}
+
+int main(int argc, char* argv[]) {
+    int days = 900;
+    std::string dir = "summary_rows_check";
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.find("--days=") == 0) {
+            days = std::atoi(arg.c_str() + 7);
+        } else if (arg.find("--dir=") == 0) {
+            dir = arg.substr(6);
+        }
+    }
+    mkdir(dir.c_str(), 0755);
+    std::string logName = dir + "/Timelog.txt";
+    std::string archiveName = dir + "/Timelog_archive.dat";
+
+    std::tm base = {};
+    base.tm_year = 120;
+    base.tm_mon = 0;
+    base.tm_mday = 6;
+    base.tm_hour = 8;
+    base.tm_isdst = -1;
+    Clock::time_point start = Clock::from_time_t(std::mktime(&base));
+    int alpha = TagTable::Intern("alpha");
+    int beta = TagTable::Intern("beta");
+
+    std::mt19937 random(1);
+    std::ofstream log(logName, std::ios::binary | std::ios::trunc);
+    for (int d = 0; d < days; d++) {
+        Clock::time_point morning = start + std::chrono::hours(24 * d);
+        if (random() % 2) {
+            log << Line(morning + std::chrono::hours(14), LogEventKind::Arrive, alpha);
+            log << Line(morning + std::chrono::hours(16) + std::chrono::minutes(random() % 60), LogEventKind::Switch, beta);
+            log << Line(morning + std::chrono::hours(17) + std::chrono::minutes(random() % 60), LogEventKind::Leave,
+                        TagTable::NO_TAG);
+        } else {
+            log << Line(morning, LogEventKind::Arrive, beta);
+            log << Line(morning + std::chrono::minutes(30 + random() % 300), LogEventKind::Leave, TagTable::NO_TAG);
+        }
+    }
+    log.close();
+
+    int firstDay = IsoCalendar::LocalDayNumber(start);
+    int bad = Check(logName, "", SummaryGrouping::Daily) + Check(logName, "", SummaryGrouping::Weekly) +
+              CheckRanges(logName, "", firstDay, days);
+    std::remove(archiveName.c_str());
+    ArchiveLogBefore(logName, archiveName, firstDay + days / 2);
+    bad += Check(logName, archiveName, SummaryGrouping::Daily) + Check(logName, archiveName, SummaryGrouping::Weekly) +
+           CheckRanges(logName, archiveName, firstDay, days);
+    bad += CheckArchivedSwitch(dir, start, alpha, beta);
+    return bad == 0 ? 0 : 1;
+}